@@ -0,0 +1,136 @@
+/*
+ * Aho-Corasick multiple string matching, for finding several search terms in one pass over a text.
+ *
+ * The automaton is built as a full DFA: every state has a transition for every byte, with the failure
+ * links already followed. That costs 512 bytes per state, but search terms are short and few, and it
+ * makes scanning a single table lookup per byte of text.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "ahocorasick.h"
+
+#define	NO_STATE	G_MAXUINT16
+
+struct AhoCorasick
+{
+	guint16		(*next)[256];		/* Transitions, indexed by state and byte. State 0 is the root. */
+	guint32		*output;		/* Patterns that end in each state, failure links included. */
+	guint32		all;			/* All patterns, once found there's no point in going on. */
+};
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+AhoCorasick * ahocorasick_new(const gchar * const *patterns, guint num_patterns)
+{
+	AhoCorasick	*ac = g_malloc(sizeof *ac);
+	guint		max_states = 1, num_states = 1, head = 0, tail = 0;
+	guint16		*fail, *queue;
+
+	num_patterns = MIN(num_patterns, AHOCORASICK_MAX_PATTERNS);
+	for (guint i = 0; i < num_patterns; i++)
+		max_states += strlen(patterns[i]);
+	max_states = MIN(max_states, NO_STATE);
+	ac->next = g_malloc(max_states * sizeof *ac->next);
+	memset(ac->next, 0xff, max_states * sizeof *ac->next);
+	ac->output = g_new0(guint32, max_states);
+	ac->all = 0;
+
+	/* First the plain trie of all the patterns. */
+	for (guint i = 0; i < num_patterns; i++)
+	{
+		guint			state = 0;
+		const guchar		*p;
+
+		for (p = (const guchar *) patterns[i]; *p != '\0'; p++)
+		{
+			if (ac->next[state][*p] == NO_STATE)
+			{
+				if (num_states == max_states)
+					break;
+				ac->next[state][*p] = num_states++;
+			}
+			state = ac->next[state][*p];
+		}
+		/* A pattern that didn't fit is left out; the states it got are only a prefix of it, and mustn't report a match. */
+		if (*p != '\0')
+			continue;
+		ac->output[state] |= 1u << i;
+		ac->all |= 1u << i;
+	}
+
+	/* Then turn it into a DFA, breadth-first so that each state's failure state is complete before it's needed. */
+	fail = g_new0(guint16, num_states);
+	queue = g_new(guint16, num_states);
+	for (guint c = 0; c < 256; c++)
+	{
+		if (ac->next[0][c] == NO_STATE)
+			ac->next[0][c] = 0;
+		else
+			queue[tail++] = ac->next[0][c];
+	}
+	while (head < tail)
+	{
+		const guint	state = queue[head++];
+
+		ac->output[state] |= ac->output[fail[state]];
+		for (guint c = 0; c < 256; c++)
+		{
+			const guint	to = ac->next[state][c];
+
+			if (to == NO_STATE)
+				ac->next[state][c] = ac->next[fail[state]][c];
+			else
+			{
+				fail[to] = ac->next[fail[state]][c];
+				queue[tail++] = to;
+			}
+		}
+	}
+	g_free(queue);
+	g_free(fail);
+
+	return ac;
+}
+
+void ahocorasick_free(AhoCorasick *ac)
+{
+	g_free(ac->next);
+	g_free(ac->output);
+	g_free(ac);
+}
+
+guint32 ahocorasick_scan(const AhoCorasick *ac, const gchar *text)
+{
+	guint32	found = ac->output[0];
+	guint	state = 0;
+
+	for (const guchar *p = (const guchar *) text; *p != '\0' && found != ac->all; p++)
+	{
+		state = ac->next[state][*p];
+		found |= ac->output[state];
+	}
+	return found;
+}
+
+guint32 ahocorasick_patterns(const AhoCorasick *ac)
+{
+	return ac->all;
+}
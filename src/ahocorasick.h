@@ -0,0 +1,40 @@
+/*
+ * Aho-Corasick multiple string matching, for finding several search terms in one pass over a text.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <glib.h>
+
+#define	AHOCORASICK_MAX_PATTERNS	32
+
+typedef struct AhoCorasick	AhoCorasick;
+
+/* Builds an automaton for up to AHOCORASICK_MAX_PATTERNS patterns; any beyond that are ignored. Matching is byte-wise, so case folding is up to the caller.
+ * There's room for 65534 bytes of patterns in all; those that don't fit are left out too, see ahocorasick_patterns().
+*/
+AhoCorasick *	ahocorasick_new(const gchar * const *patterns, guint num_patterns);
+void		ahocorasick_free(AhoCorasick *ac);
+
+/* Returns a bit mask with bit i set if pattern i occurs in <text>. */
+guint32		ahocorasick_scan(const AhoCorasick *ac, const gchar *text);
+
+/* Returns a bit mask with bit i set if pattern i is in the automaton. Any others are never reported by ahocorasick_scan(),
+ * so the caller has to look for them some other way.
+*/
+guint32		ahocorasick_patterns(const AhoCorasick *ac);
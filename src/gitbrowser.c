@@ -23,19 +23,37 @@
 #include <string.h>
 
 #include <gdk/gdkkeysyms.h>
+#include <glib/gstdio.h>
 
 #include "geanyplugin.h"
 
+#include "ahocorasick.h"
+#include "gitindex.h"
 #include "levenshtein.h"
+#include "roaring.h"
+#include "strtab.h"
+#include "symbols.h"
 
 #define	MNEMONIC_NAME			"gitbrowser"
 #define	CFG_REPOSITORIES		"repositories"
 #define	CFG_EXPANDED			"expanded"
 #define	CFG_QUICK_OPEN_FILTER_MAX_TIME	"quick_open_filter_max_time"
 #define	CFG_QUICK_OPEN_HIDE_SRC		"quick_open_hide_re"
+#define	CFG_QUICK_OPEN_MEMORY_BUDGET	"quick_open_memory_budget"
+#define	CFG_QUICK_OPEN_MAX_ROWS		"quick_open_max_rows"
+#define	CFG_QUICK_OPEN_PREVIEW		"quick_open_preview"
+#define	CFG_QUICK_OPEN_UNTRACKED	"quick_open_untracked"
 #define	CFG_TERMINAL_CMD		"terminal_cmd"
 #define	PATH_SEPARATOR_CHAR		':'
 #define	REPO_IS_SEPARATOR		"-"
+#define	PREVIEW_READ_MAX		4096		/* Bytes read from the start of a previewed file; about a screenful. */
+#define	PREVIEW_LINES_MAX		60
+#define	PREVIEW_FILE_MAX		(16 << 20)	/* Files larger than this aren't previewed at all. */
+#define	SYMBOLS_FILE_MAX		(1 << 20)	/* Files larger than this aren't searched for symbols. */
+#define	SYMBOLS_CACHE_HEADER		"gitbrowser symbols 2\n"
+#define	SYMBOLS_JOB_FILES		64		/* Files handed to the symbol pool together, as one job. */
+#define	RECENCY_COMMITS			200		/* How far back in history to look for recently committed files. */
+#define	RECENCY_BOOST_MAX		4		/* The most that being recently committed lowers a file's distance. */
 
 enum
 {
@@ -53,6 +71,7 @@ enum
 	CMD_REPOSITORY_MOVE_UP,
 	CMD_REPOSITORY_MOVE_DOWN,
 
+	CMD_DIR_OPEN_QUICK,
 	CMD_DIR_EXPAND,
 	CMD_DIR_COLLAPSE,
 	CMD_DIR_EXPLORE,
@@ -71,24 +90,114 @@ enum {
 };
 
 enum {
-	QO_NAME = 0,
-	QO_NAME_LOWER,
-	QO_PATH,
-	QO_VISIBLE,
-	QO_DISTANCE,
+	QO_ROW = 0,
 	QO_NUM_COLUMNS
 } QuickOpenColumns;
 
-/* Data held in the 'names' array of QuickOpenInfo. Faster than storing GString, keeps data
- * const in the list store, reducing dynamic memory management overhead when reading from it.
+/* The QO_ROW value of the "show more" row at the end of a capped list. */
+#define	QO_ROW_MORE	G_MAXUINT
+
+/* The files listed by Quick Open, stored column-wise ("struct of arrays") rather than as one struct
+ * per row. That is less than half the size, and the filtering and sorting passes only stream through
+ * the columns they actually need. The list store holds nothing but row numbers into this.
+*/
+typedef struct {
+	StrTab		names;			/* All names (files and paths), de-duplicated. Saves tons of memory. */
+	guint32		*name;			/* Ids into 'names', for each row. */
+	guint32		*name_lower;		/* For case-insensitive searching. */
+	guint32		*path;
+	guint16		*distance;		/* Levenshtein distance to typed string. */
+	guint32		*visible;		/* Bitset, one bit per row. */
+	guint32		*dead;			/* Bitset of rows whose files are gone; they're re-used before new rows are appended. */
+	guint32		*free_rows;		/* The dead rows, as a stack. */
+	guint32		num_free;
+	guint32		max_free;
+	guint32		*file;			/* Only for symbols: the name of the file the symbol is in. The directory is in 'path'. */
+	guint32		*line;			/* Only for symbols: line number, starting at 1. */
+	guint8		*recency;		/* Only for files: how recently the file was committed, 1 to 255, or 0 if not lately. */
+	guint32		*recent;		/* The rows given a recency, so they can be found without looking through them all. */
+	guint32		num_recent;
+	GHashTable	*extensions;		/* Lower-case file name extension (in 'names') to RoaringBitmap of its rows. */
+	guint32		rows;
+	guint32		rows_max;
+} QuickOpenIndex;
+
+#define	BITSET_WORDS(n)		(((n) + 31) / 32)
+#define	BITSET_TEST(s, i)	(((s)[(i) >> 5] >> ((i) & 31)) & 1)
+#define	BITSET_SET(s, i)	((s)[(i) >> 5] |= 1u << ((i) & 31))
+#define	BITSET_CLEAR(s, i)	((s)[(i) >> 5] &= ~(1u << ((i) & 31)))
+
+static guint bit_count(guint32 bits)
+{
+	guint	count = 0;
+
+	for (; bits != 0; bits &= bits - 1)
+		count++;
+	return count;
+}
+
+/* Repositories listed at once, at most. */
+#define	LIST_POOL_THREADS	4
+
+/* Where an index's digest starts, before any entries; the FNV-1a offset basis. */
+#define	LIST_DIGEST_INITIAL	G_GUINT64_CONSTANT(14695981039346656037)
+
+/* How long a watched repository's index and HEAD must be left alone before it's refreshed, in milliseconds. */
+#define	WATCH_QUIET_TIME	500
+
+/* Marks a file table entry that has no row in the Quick Open list, since it's hidden. */
+#define	QO_NO_ROW	G_MAXUINT32
+
+/* The files in a repository, as listed by git. Both the sidebar tree and the Quick Open list are built from this. */
+typedef struct {
+	gchar		*buffer;		/* The paths, each terminated, as from 'git ls-files -z'. Sidebar rows point into this, so it outlives them. */
+	gsize		size;
+	gsize		size_max;
+	guint32		*offset;		/* Where each file's (repository-relative) path starts in 'buffer'. */
+	guint32		num_files;
+	guint32		max_files;
+	guint8		checksum[GITINDEX_OID_SIZE];	/* Of the index the files were read from, see gitindex_checksum() ... */
+	gboolean	checksum_valid;			/* ... if they were; not if git listed them. */
+	guint64		digest;				/* Of the index entries' paths, modes and stages; see list_build_digest(). */
+} FileTable;
+
+/* The directory tree of a file table, as a flat array of nodes linked by index. Node 0 is the root. Since git lists the
+ * files in sorted order, all the files in a directory come in one run, so the tree is built in a single pass with a stack
+ * of the directories the previous file was in: a new file shares some of those, and the rest of its path is appended.
+ * This is what the sidebar shows, as is; see SidebarModel.
 */
 typedef struct {
-	gpointer	name;
-	gpointer	name_lower;		/* For case-insensitive searching. */
-	gpointer	path;
-	guint16		distance;		/* Levenshtein distance to typed string. */
-} QuickOpenRow;
+	guint32		name;			/* Offset of the path component in the file table's buffer; it ends at a slash or terminator. */
+	guint32		display;		/* 1 + offset of the display name in the tree's 'names', or 0 if 'name' is terminated and in UTF-8. */
+	guint32		parent;
+	guint32		first_child;		/* Index of the first child, or 0 for files (the root is nobody's child). */
+	guint32		next_sibling;		/* Or 0 for the last one. Directories come before files, each in strcmp() order. */
+} FileNode;
 
+typedef struct {
+	FileNode	*nodes;
+	guint32		num_nodes;
+	guint32		max_nodes;
+	guint32		*open;			/* Stack of directories the previous file was in, starting at the root ... */
+	guint32		*open_last;		/* ... and the last child of each, to append to. */
+	guint32		num_open;
+	guint32		max_open;
+	guint32		*unsorted;		/* Directories whose children didn't come in strcmp() order; sorted when done. */
+	guint32		num_unsorted;
+	guint32		max_unsorted;
+	gchar		*names;			/* Display names that aren't just a component in the file table, each terminated. */
+	gsize		names_size;
+	gsize		names_max;
+	gboolean	contiguous;		/* Each directory's children are numbered consecutively, in order; see file_tree_finish(). */
+} FileTree;
+
+typedef struct Repository	Repository;
+typedef struct SubprocessStream	SubprocessStream;
+typedef struct SymbolBuild	SymbolBuild;
+typedef struct RecencyBuild	RecencyBuild;
+typedef struct ListBuild	ListBuild;
+
+/* The Quick Open dialog. There's just the one, it's re-targeted at whichever repository it's opened for. */
 typedef struct
 {
 	GtkWidget		*dialog;
@@ -96,27 +205,87 @@ typedef struct
 	GtkWidget		*entry;
 	GtkWidget		*spinner;
 	GtkWidget		*label;
+	GtkWidget		*preview_box;		/* Scrolled window around the preview, for showing/hiding it. */
+	GtkWidget		*preview;
+	GCancellable		*preview_cancel;	/* For the preview being read right now, if any. */
 	GtkTreeSelection	*selection;
-	gulong			files_total;
 	gulong			files_filtered;
-	GtkListStore	*store;			/* Only pointers into 'names' in here. */
-	GString			*names;			/* All names (files and paths), concatenated with '\0's in-between. */
-	GHashTable		*dedup;			/* Used during construction to de-duplicate names. Saves tons of memory. */
-	GArray			*array;			/* Used during construction to sort quickly. */
-	GtkTreeModel	*filter;		/* Filtered view of the quick open model. */
-	GtkTreeModel	*sort;			/* Sorted view of the filtered model. */
-	gchar			filter_text[128];	/* Cached so we don't need to query GtkEntry on each filter callback. */
+	Repository		*repo;			/* The repository currently shown, or NULL. */
+	QuickOpenIndex	*index;			/* The index the store was populated from. */
+	GtkListStore	*store;			/* The best-ranked matches, as row numbers into 'index', in order. */
+	guint32			*shown;			/* The rows in 'store', not counting any "show more" row. */
+	guint32			shown_rows;
+	guint32			shown_max;		/* How many rows to show; grows in steps when asked for more. */
+	guint32			shown_alloc;
+	gchar			*scope;			/* Display path of the directory to look in, or NULL for the whole repository. */
+	gchar			*scope_prefix;		/* The same directory relative to the repository, as git has it, with a trailing '/'. */
+	guint32			*scope_rows;		/* The index's rows in 'scope'; filtering looks at nothing else. */
+	guint32			scope_num;
+	guint32			scope_alloc;
+	gboolean		scope_valid;		/* If 'scope_rows' is up to date with the index. */
+	gboolean		symbols;		/* Looking for symbols rather than files, i.e. the filter began with '@'. */
+	gchar			filter_text[128];	/* The text to rank by; the filter, or its first term. */
 	gchar			filter_lower[128];	/* Lower-case version of the filter text. */
+	GRegex			*filter_regex;		/* If the filter began with '/', the rest compiled. Matched against lower-case names. */
+	gchar			**filter_literals;	/* Lower-case strings any match of 'filter_regex' must contain, for a quick check first. */
+	gboolean		filter_invalid;		/* If the regex didn't compile; nothing matches, then. */
+	gchar			**filter_extensions;	/* Lower-case extensions from "*.ext" terms, or NULL to not filter on extension. */
+	guint32			*filter_mask;		/* Bitset of the rows with any of those extensions; nothing else is even looked at. */
+	guint32			filter_mask_rows;	/* How many rows 'filter_mask' covers; it's re-built when rows are added. */
+	AhoCorasick		*filter_ac;		/* For several terms, all searched for in one pass. */
+	guint32			filter_need;		/* Terms (as bits from 'filter_ac') that must be present ... */
+	guint32			filter_reject;		/* ... and those that must not, having been given as "!term". */
+	guint32			filter_spilled;		/* Terms there was no room for in 'filter_ac', searched for one by one ... */
+	gchar			*filter_spill[AHOCORASICK_MAX_PATTERNS];	/* ... as these, by bit. */
 	guint			filter_idle;
 	guint			filter_row;		/* For the idle function. */
+	gboolean		filter_pending;		/* The entry changed during a pass; picked up by the next slice, with any further changes. */
+	gboolean		filter_first;		/* The next slice is the pass's first, which ends by showing the matches found. */
+	gint64			filter_slice;		/* How long to filter for per slice, in microseconds. Adapts to the frame rate. */
+	gint64			filter_slice_end;	/* Monotonic time the last slice ended, or 0 before the first. */
 	LDState			filter_ld;
 } QuickOpenInfo;
 
-typedef struct
+struct Repository
 {
 	gchar			root_path[1024];	/* Root path, this is where the ".git/" subdirectory is. */
-	QuickOpenInfo	quick_open;			/* State tracking for the "Quick Open" command's dialog. */
-} Repository;
+	gchar			*git_dir;		/* Where git keeps the repository's state, usually in ".git/". Known once listed. */
+	FileTable		files;
+	FileTree		tree;			/* Directory tree of 'files'; the sidebar is filled in from this as it's expanded. */
+	ListBuild		*list_build;		/* While the files are being listed; 'files' is replaced when that's done. */
+	QuickOpenIndex	*quick_open;		/* The files shown by Quick Open. Built on demand, dropped when memory is tight. */
+	guint32			*quick_open_rows;	/* For each file in 'files', its row in 'quick_open' (or QO_NO_ROW). */
+	guint32			quick_open_tracked;	/* Rows in 'quick_open' below this are from 'files', any others are untracked files. */
+	gint64			quick_open_used;	/* Monotonic time of last use, for least-recently-used eviction. */
+	SubprocessStream	*untracked;		/* Lists untracked files into 'quick_open', while running. */
+	QuickOpenIndex	*symbols;		/* Symbols for Quick Open, built on demand in the background. Dropped with 'quick_open'. */
+	SymbolBuild		*symbols_build;		/* While 'symbols' is being built. */
+	GHashTable		*recency;		/* Recently committed files (paths as in 'files') to their recency. */
+	gchar			recency_head[64];	/* The commit 'recency' was found from. It's re-used for as long as that's HEAD. */
+	RecencyBuild		*recency_build;		/* While 'recency' is being found. */
+	GFileMonitor		*watch[2];		/* On the index and HEAD in 'git_dir', once known. */
+	guint			watch_quiet;		/* Timeout for the refresh, while they're changing. */
+};
+
+/* The sidebar's tree model. A GtkTreeStore would hold a copy of every file's name in a row of its own; this shows the
+ * repositories' file trees as they are instead, so a row is just a node index, and the strings are those already in the
+ * file tables. Iterators are (repository, node) for files and directories, and an index into 'rows' for the rows under
+ * the top one; see sidebar_model_iter_node() and sidebar_model_iter_row().
+*/
+typedef struct {
+	Repository	*repo;			/* NULL for separators. */
+	gchar		*label;			/* Repository name and branch, NULL for separators. */
+} SidebarRow;
+
+typedef struct {
+	GObject		parent;
+	gint		stamp;
+	GArray		*rows;			/* The repositories and separators, in order. */
+} SidebarModel;
+
+typedef struct {
+	GObjectClass	parent_class;
+} SidebarModelClass;
 
 static struct
 {
@@ -129,8 +298,14 @@ static struct
 	GRegex		*quick_open_hide;
 
 	GtkWidget	*add_dialog;
+	QuickOpenInfo	quick_open;			/* State tracking for the "Quick Open" command's dialog. */
 
 	GHashTable	*repositories;			/* Hashed on root path. */
+	gchar		*expanded;			/* Expanded rows from the configuration, applied to each repository once it's listed. */
+	GThreadPool	*symbol_pool;			/* Finds symbols in files, created when first needed. */
+	GThreadPool	*list_pool;			/* Lists repositories' files, likewise. */
+	guint		list_sequence;
+	GSList		*list_cancelled;		/* Builds cancelled while in the list pool, freed as they come back. */
 
 	GeanyKeyGroup	*key_group;
 
@@ -139,6 +314,10 @@ static struct
 
 	gchar		*quick_open_hide_src;
 	gint		quick_open_filter_max_time;	/* In milliseconds. */
+	gint		quick_open_memory_budget;	/* In megabytes, for all repositories' Quick Open lists together. */
+	gint		quick_open_max_rows;		/* Matches shown at once, the rest are behind a "show more" row. */
+	gboolean	quick_open_preview;
+	gboolean	quick_open_untracked;
 	gchar		*terminal_cmd;
 
 	GeanyPlugin	*plugin;
@@ -148,6 +327,10 @@ typedef struct
 {
 	GtkWidget	*filter_re;
 	GtkWidget	*filter_time;
+	GtkWidget	*memory_budget;
+	GtkWidget	*max_rows;
+	GtkWidget	*preview;
+	GtkWidget	*untracked;
 	GtkWidget	*terminal_cmd;
 } PrefsWidgets;
 
@@ -163,6 +346,7 @@ static void cmd_repository_grep(GtkWidget *this, gpointer user);
 static void cmd_repository_refresh(GtkWidget *this, gpointer user);
 static void cmd_repository_move_up(GtkWidget *this, gpointer user);
 static void cmd_repository_move_down(GtkWidget *this, gpointer user);
+static void cmd_dir_open_quick(GtkWidget *this, gpointer user);
 static void cmd_dir_expand(GtkWidget *this, gpointer user);
 static void cmd_dir_collapse(GtkWidget *this, gpointer user);
 static void cmd_dir_explore(GtkWidget *this, gpointer user);
@@ -187,6 +371,7 @@ static const struct {
 	{ _("Refresh"), _("Reloads the list of files contained in the repository"), cmd_repository_refresh },
 	{ _("Move Up"), _("Moves a repository up in the list."), cmd_repository_move_up },
 	{ _("Move Down"), _("Moves a repository down in the list."), cmd_repository_move_down },
+	{ _("Quick Open Here ..."), _("Opens a document in this directory or below it, with filtering."), cmd_dir_open_quick },
 	{ _("Expand All"), _("Expands a directory node."), cmd_dir_expand },
 	{ _("Collapse All"), _("Collapses a directory node."), cmd_dir_collapse },
 	{ _("Explore ..."), _("Opens the directory containing this item, using the system's default file browser."), cmd_dir_explore },
@@ -197,19 +382,58 @@ static const struct {
 
 /* -------------------------------------------------------------------------------------------------------------- */
 
+void			file_table_clear(FileTable *ft);
+void			file_table_append(FileTable *ft, const gchar *data, gsize len, gchar separator);
+guint32			file_table_lower_bound(const FileTable *ft, const gchar *path);
+void			file_tree_init(FileTree *tree);
+void			file_tree_clear(FileTree *tree);
+void			file_tree_add(FileTree *tree, const FileTable *files, guint32 first);
+void			file_tree_finish(FileTree *tree, const gchar *buffer);
+
 Repository *	repository_new(const gchar *root_path);
+void			repository_free(Repository *repo);
 Repository *	repository_find_by_path(const gchar *path);
+const gchar *	repository_get_name(const Repository *repo);
+const gchar *	repository_get_label(const Repository *repo, const gchar *branch, gchar *buf, gsize buf_max);
 void			repository_open_quick(Repository *repo);
-
+void			repository_open_quick_in(Repository *repo, const gchar *dir);
+
+static void	repository_free_all(void);
+static void	symbol_cache_remove(const Repository *repo);
+static void	repository_drop_quick_open(Repository *repo);
+static gboolean	repository_update_quick_open(Repository *repo, const FileTable *old);
+static void	repository_recency_start(Repository *repo);
+static void	repository_recency_cancel(Repository *repo);
+static void	repository_list_cancel(Repository *repo);
+static void	repository_list_settle(void);
+static void	repository_list_hold(gboolean hold);
+static void	cb_repository_list_startup(GObject *object, gpointer user);
+static void	repository_watch_stop(Repository *repo);
+static void	open_quick_detach(QuickOpenInfo *qoi);
+static void	open_quick_rows_added(QuickOpenInfo *qoi, guint32 first);
+static void	open_quick_reshow(QuickOpenInfo *qoi);
+static void	open_quick_rows_changed(QuickOpenInfo *qoi, const guint32 *rows, guint32 num_rows);
+static void	open_quick_update_label(QuickOpenInfo *qoi);
+static void	open_quick_attach(QuickOpenInfo *qoi, Repository *repo, QuickOpenIndex *idx);
+static void	symbol_build_cancel(SymbolBuild *build);
 static void	open_quick_reset_filter(void);
+static void	open_quick_filter_start(QuickOpenInfo *qoi);
+static void	open_quick_filter_changed(QuickOpenInfo *qoi);
+static void	open_quick_enforce_budget(const Repository *keep);
 
 gboolean	tree_model_find_repository(GtkTreeModel *model, const gchar *root_path, GtkTreeIter *iter);
-void		tree_model_build_repository(GtkTreeModel *model, GtkTreeIter *root, const gchar *root_path);
+void		tree_model_build_repository(GtkTreeModel *model, GtkTreeIter *root, Repository *repo);
 void		tree_model_build_separator(GtkTreeModel *model);
 gboolean	tree_model_open_document(GtkTreeModel *model, GtkTreePath *path);
 gboolean	tree_model_get_document_path(GtkTreeModel *model, const GtkTreeIter *iter, gchar *buf, gsize buf_max);
 void		tree_model_foreach(GtkTreeModel *model, GtkTreeIter *root, void (*node_callback)(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer user), gpointer user);
 
+static void	tree_model_append(GtkTreeModel *model, Repository *repo, const gchar *label, GtkTreeIter *iter);
+static void	tree_model_set_label(GtkTreeModel *model, GtkTreeIter *iter, const gchar *label);
+static void	tree_model_remove(GtkTreeModel *model, GtkTreeIter *iter);
+static void	tree_model_swap(GtkTreeModel *model, GtkTreeIter *a, GtkTreeIter *b);
+static void	tree_model_set_files(GtkTreeModel *model, GtkTreeIter *iter, FileTable *files, FileTree *tree);
+
 GString *	tree_view_get_expanded(GtkTreeView *view);
 void		tree_view_set_expanded(GtkTreeView *view, const gchar *paths);
 
@@ -225,6 +449,119 @@ gboolean subprocess_run(const gchar* working_dir, gchar **argv, gchar **env, gch
 	return g_spawn_sync(working_dir, argv, env, G_SPAWN_SEARCH_PATH, NULL, NULL, output, error, NULL, NULL);
 }
 
+/* Runs a command in the background, handing its output over in chunks as it arrives. Each chunk holds only
+ * complete records (terminated by 'separator'), and is writable so it can be parsed in place.
+*/
+struct SubprocessStream
+{
+	GSubprocess	*process;
+	GCancellable	*cancel;
+	GByteArray	*pending;		/* Output not yet handed over, the tail is an incomplete record. */
+	gchar		separator;
+	void		(*records)(gchar *data, gsize len, gpointer user);
+	void		(*done)(gboolean success, gpointer user);
+	gpointer	user;
+};
+
+#define	SUBPROCESS_STREAM_READ	(64 << 10)
+
+static void subprocess_stream_free(SubprocessStream *ss)
+{
+	g_object_unref(ss->process);
+	g_object_unref(ss->cancel);
+	g_byte_array_free(ss->pending, TRUE);
+	g_free(ss);
+}
+
+static void cb_subprocess_stream_exited(GObject *source, GAsyncResult *res, gpointer user)
+{
+	SubprocessStream	*ss = user;
+	const gboolean		success = g_subprocess_wait_check_finish(ss->process, res, NULL);
+
+	if (!g_cancellable_is_cancelled(ss->cancel))
+		ss->done(success, ss->user);
+	subprocess_stream_free(ss);
+}
+
+static void cb_subprocess_stream_read(GObject *source, GAsyncResult *res, gpointer user)
+{
+	SubprocessStream	*ss = user;
+	GBytes			*bytes = g_input_stream_read_bytes_finish(G_INPUT_STREAM(source), res, NULL);
+	gsize			size;
+
+	if (bytes == NULL || g_cancellable_is_cancelled(ss->cancel))
+	{
+		if (bytes != NULL)
+			g_bytes_unref(bytes);
+		if (!g_cancellable_is_cancelled(ss->cancel))
+			ss->done(FALSE, ss->user);
+		subprocess_stream_free(ss);
+		return;
+	}
+	if ((size = g_bytes_get_size(bytes)) > 0)
+	{
+		const guint8	*sep;
+
+		g_byte_array_append(ss->pending, g_bytes_get_data(bytes, NULL), size);
+		/* Hand over everything up to and including the last separator, keep the rest for next time. */
+		for (sep = ss->pending->data + ss->pending->len; sep > ss->pending->data && sep[-1] != (guint8) ss->separator; sep--)
+			;
+		if (sep > ss->pending->data)
+		{
+			const gsize	len = sep - ss->pending->data;
+
+			ss->records((gchar *) ss->pending->data, len, ss->user);
+			g_byte_array_remove_range(ss->pending, 0, len);
+		}
+		g_input_stream_read_bytes_async(G_INPUT_STREAM(source), SUBPROCESS_STREAM_READ, G_PRIORITY_DEFAULT_IDLE, ss->cancel, cb_subprocess_stream_read, ss);
+	}
+	else
+	{
+		/* End of output. A last record without a separator is still a record. */
+		if (ss->pending->len > 0)
+		{
+			g_byte_array_append(ss->pending, (const guint8 *) &ss->separator, 1);
+			ss->records((gchar *) ss->pending->data, ss->pending->len, ss->user);
+		}
+		g_subprocess_wait_check_async(ss->process, ss->cancel, cb_subprocess_stream_exited, ss);
+	}
+	g_bytes_unref(bytes);
+}
+
+/* Starts running a command. Returns NULL if it can't be started, otherwise <done> is called once it's over. */
+SubprocessStream * subprocess_stream_start(const gchar *working_dir, const gchar * const *argv, gchar separator,
+					void (*records)(gchar *data, gsize len, gpointer user), void (*done)(gboolean success, gpointer user), gpointer user)
+{
+	GSubprocessLauncher	*launcher = g_subprocess_launcher_new(G_SUBPROCESS_FLAGS_STDOUT_PIPE | G_SUBPROCESS_FLAGS_STDERR_SILENCE);
+	GSubprocess		*process;
+	SubprocessStream	*ss;
+
+	g_subprocess_launcher_set_cwd(launcher, working_dir);
+	process = g_subprocess_launcher_spawnv(launcher, argv, NULL);
+	g_object_unref(launcher);
+	if (process == NULL)
+		return NULL;
+
+	ss = g_malloc(sizeof *ss);
+	ss->process = process;
+	ss->cancel = g_cancellable_new();
+	ss->pending = g_byte_array_sized_new(SUBPROCESS_STREAM_READ);
+	ss->separator = separator;
+	ss->records = records;
+	ss->done = done;
+	ss->user = user;
+	g_input_stream_read_bytes_async(g_subprocess_get_stdout_pipe(process), SUBPROCESS_STREAM_READ, G_PRIORITY_DEFAULT_IDLE, ss->cancel, cb_subprocess_stream_read, ss);
+
+	return ss;
+}
+
+/* Stops the command. Neither callback is called after this, and the stream frees itself. */
+void subprocess_stream_cancel(SubprocessStream *ss)
+{
+	g_subprocess_force_exit(ss->process);
+	g_cancellable_cancel(ss->cancel);
+}
+
 /* -------------------------------------------------------------------------------------------------------------- */
 
 static void add_dialog_open(const gchar *title)
@@ -250,13 +587,13 @@ static void cmd_repository_add(GtkWidget *this, gpointer user)
 			/* Not already loaded? */
 			if (repository_find_by_path(path) == NULL)
 			{
-				/* Does it even have a ".git" directory in it? */
+				/* Does it even have a ".git" in it? Worktrees and submodules have a file pointing elsewhere. */
 				char * const git = g_build_filename(path, ".git", NULL);
-				if (g_file_test(git, G_FILE_TEST_IS_DIR))
+				if (g_file_test(git, G_FILE_TEST_EXISTS))
 				{
 					Repository	*repo = repository_new(path);
 
-					tree_model_build_repository(gitbrowser.model, NULL, repo->root_path);
+					tree_model_build_repository(gitbrowser.model, NULL, repo);
 				}
 				g_free(git);
 			}
@@ -289,10 +626,10 @@ static void add_multiple(const char *root)
 				gchar	*git = g_build_filename(full, ".git", NULL);
 				if(git == NULL)
 					break;
-				if(g_file_test(git, G_FILE_TEST_IS_DIR))
+				if(g_file_test(git, G_FILE_TEST_EXISTS))
 				{
 					Repository	*repo = repository_new(full);
-					tree_model_build_repository(gitbrowser.model, NULL, repo->root_path);
+					tree_model_build_repository(gitbrowser.model, NULL, repo);
 				}
 				else	/* This is the recursive step. */
 					add_multiple(full);
@@ -325,7 +662,7 @@ static void cmd_repository_add_from_document(GtkWidget *this, gpointer user)
 	{
 		GString	*tmp = g_string_new(doc->real_path);
 
-		/* Step up through the directory hierarchy, looking for a ".git" directory that marks the repo's root. */
+		/* Step up through the directory hierarchy, looking for the ".git" that marks the repo's root. */
 		for (;;)
 		{
 			gchar	*slash, *git, *name;
@@ -334,7 +671,7 @@ static void cmd_repository_add_from_document(GtkWidget *this, gpointer user)
 			{
 				*slash = '\0';	/* Stamp out the slash, truncating the path. */
 				git = g_build_filename(tmp->str, ".git", NULL);
-				if (g_file_test(git, G_FILE_TEST_IS_DIR))
+				if (g_file_test(git, G_FILE_TEST_EXISTS))
 				{
 					name = strrchr(tmp->str, G_DIR_SEPARATOR);
 					if (name != NULL)
@@ -345,7 +682,7 @@ static void cmd_repository_add_from_document(GtkWidget *this, gpointer user)
 						{
 							Repository	*repo = repository_new(tmp->str);
 
-							tree_model_build_repository(gitbrowser.model, NULL, repo->root_path);
+							tree_model_build_repository(gitbrowser.model, NULL, repo);
 						}
 						tmp->str[0] = '\0';
 					}
@@ -369,21 +706,41 @@ static void cmd_repository_remove(GtkWidget *this, gpointer user)
 
 	if (gtk_tree_model_get_iter(gitbrowser.model, &iter, gitbrowser.click_path))
 	{
-		gtk_tree_store_remove(GTK_TREE_STORE(gitbrowser.model), &iter);
+		const gchar	*root_path = NULL;
+
+		gtk_tree_model_get(gitbrowser.model, &iter, 1, &root_path, -1);
+		tree_model_remove(gitbrowser.model, &iter);
+		/* Separators have no path, and no repository. */
+		if (root_path != NULL)
+		{
+			Repository	*repo = g_hash_table_lookup(gitbrowser.repositories, root_path);
+
+			if (repo != NULL)
+			{
+				symbol_cache_remove(repo);
+				repository_free(repo);
+			}
+		}
 	}
 }
 
 static void cmd_repository_remove_all(GtkWidget *this, gpointer user)
 {
 	GtkTreeIter	iter, child;
+	GHashTableIter	repos;
+	gpointer	value;
 
 	if (gtk_tree_model_get_iter_first(gitbrowser.model, &iter))
 	{
 		while (gtk_tree_model_iter_children(gitbrowser.model, &child, &iter))
 		{
-			gtk_tree_store_remove(GTK_TREE_STORE(gitbrowser.model), &child);
+			tree_model_remove(gitbrowser.model, &child);
 		}
 	}
+	g_hash_table_iter_init(&repos, gitbrowser.repositories);
+	while (g_hash_table_iter_next(&repos, NULL, &value))
+		symbol_cache_remove(value);
+	repository_free_all();
 }
 
 static void cmd_repository_open_quick(GtkWidget *this, gpointer user)
@@ -393,14 +750,10 @@ static void cmd_repository_open_quick(GtkWidget *this, gpointer user)
 
 	if (gtk_tree_model_get_iter(gitbrowser.model, &iter, gitbrowser.click_path))
 	{
-		gchar	*path = NULL;
+		const gchar	*path = NULL;
 
 		gtk_tree_model_get(gitbrowser.model, &iter, 1, &path, -1);
-		if (path != NULL)
-		{
-			repo = repository_find_by_path(path);
-			g_free(path);
-		}
+		repo = repository_find_by_path(path);
 	}
 	repository_open_quick(repo);
 }
@@ -428,14 +781,10 @@ static const Repository * get_repository(void)
 	
 		if (gtk_tree_model_get_iter(gitbrowser.model, &iter, gitbrowser.click_path))
 		{
-			gchar	*path = NULL;
+			const gchar	*path = NULL;
 
 			gtk_tree_model_get(gitbrowser.model, &iter, 1, &path, -1);
-			if (path != NULL)
-			{
-				repo = repository_find_by_path(path);
-				g_free(path);
-			}
+			repo = repository_find_by_path(path);
 		}
 	}
 	if (doc != NULL && repo == NULL)
@@ -577,30 +926,17 @@ static void cmd_repository_grep(GtkWidget *this, gpointer user)
 
 static void cmd_repository_refresh(GtkWidget *this, gpointer user)
 {
-	GtkTreeIter	iter, child;
+	GtkTreeIter	iter;
 	Repository	*repo = NULL;
 
 	if (gtk_tree_model_get_iter(gitbrowser.model, &iter, gitbrowser.click_path))
 	{
-		gchar	*path = NULL;
+		const gchar	*path = NULL;
 
 		gtk_tree_model_get(gitbrowser.model, &iter, 1, &path, -1);
-		if (path != NULL)
-		{
-			repo = repository_find_by_path(path);
-			if (repo != NULL)
-			{
-				/* First, clear away all the (top-level) child nodes of the repo, since we're about to re-build them. */
-				if (gtk_tree_model_iter_children(gitbrowser.model, &child, &iter))
-				{
-					while (gtk_tree_store_remove(GTK_TREE_STORE(gitbrowser.model), &child))
-						;
-					/* Then simply build it again. */
-					tree_model_build_repository(gitbrowser.model, &iter, repo->root_path);
-				}
-			}
-			g_free(path);
-		}
+		/* The rows that changed are replaced, and the Quick Open list brought up to date, once the files have been listed again. */
+		if ((repo = repository_find_by_path(path)) != NULL)
+			tree_model_build_repository(gitbrowser.model, &iter, repo);
 	}
 }
 
@@ -617,7 +953,7 @@ static void cmd_repository_move_up(GtkWidget *this, gpointer user)
 		if (gtk_tree_path_prev(path_prev))
 		{
 			if (gtk_tree_model_get_iter(GTK_TREE_MODEL(gitbrowser.model), &prev, path_prev))
-				gtk_tree_store_move_before(GTK_TREE_STORE(gitbrowser.model), &here, &prev);
+				tree_model_swap(gitbrowser.model, &here, &prev);
 		}
 		gtk_tree_path_free(path_prev);
 	}
@@ -635,11 +971,33 @@ static void cmd_repository_move_down(GtkWidget *this, gpointer user)
 		path_next = gtk_tree_path_copy(gitbrowser.click_path);
 		gtk_tree_path_next(path_next);
 		if (gtk_tree_model_get_iter(GTK_TREE_MODEL(gitbrowser.model), &next, path_next))
-			gtk_tree_store_move_after(GTK_TREE_STORE(gitbrowser.model), &here, &next);
+			tree_model_swap(gitbrowser.model, &here, &next);
 		gtk_tree_path_free(path_next);
 	}
 }
 
+static void cmd_dir_open_quick(GtkWidget *this, gpointer user)
+{
+	GtkTreeIter	iter;
+
+	if (gtk_tree_model_get_iter(gitbrowser.model, &iter, gitbrowser.click_path))
+	{
+		gchar		buf[1024];
+		Repository	*repo;
+
+		tree_model_get_document_path(gitbrowser.model, &iter, buf, sizeof buf);
+		if ((repo = repository_find_by_path(buf)) != NULL)
+		{
+			gchar	*dir = buf + strlen(repo->root_path);
+
+			if (*dir == G_DIR_SEPARATOR)
+				dir++;
+			g_strdelimit(dir, G_DIR_SEPARATOR_S, '/');
+			repository_open_quick_in(repo, dir);
+		}
+	}
+}
+
 static void cmd_dir_expand(GtkWidget *this, gpointer user)
 {
 	gtk_tree_view_expand_row(GTK_TREE_VIEW(gitbrowser.view), gitbrowser.click_path, TRUE);
@@ -790,841 +1148,4016 @@ gchar * tok_tokenize_next(gchar *text, gchar **endptr, gchar separator)
 
 /* -------------------------------------------------------------------------------------------------------------- */
 
-Repository * repository_new(const gchar *root_path)
+void file_table_clear(FileTable *ft)
 {
-	Repository	*r = g_malloc(sizeof *r);
-
-	g_strlcpy(r->root_path, root_path, sizeof r->root_path);
+	g_free(ft->buffer);
+	ft->buffer = NULL;
+	ft->size = 0;
+	ft->size_max = 0;
+	g_free(ft->offset);
+	ft->offset = NULL;
+	ft->num_files = 0;
+	ft->max_files = 0;
+	memset(ft->checksum, 0, sizeof ft->checksum);
+	ft->checksum_valid = FALSE;
+	ft->digest = 0;
+}
 
-	r->quick_open.dialog = NULL;
-	r->quick_open.filter = NULL;
-	r->quick_open.sort = NULL;
-	r->quick_open.selection = NULL;
-	r->quick_open.files_total = 0;
-	r->quick_open.files_filtered = 0;
-	r->quick_open.store = NULL;
-	r->quick_open.names = NULL;
-	r->quick_open.view = NULL;
-	r->quick_open.filter_text[0] = '\0';
-	r->quick_open.filter_lower[0] = '\0';
-	r->quick_open.filter_idle = 0;
+/* Appends a chunk of 'git ls-files' output, holding only complete paths each ended by <separator>. */
+void file_table_append(FileTable *ft, const gchar *data, gsize len, gchar separator)
+{
+	const gchar	*end;
+	gchar		*put;
 
-	g_hash_table_insert(gitbrowser.repositories, r->root_path, r);
+	if (ft->size + len > ft->size_max)
+	{
+		ft->size_max = MAX(2 * ft->size_max, ft->size + len);
+		ft->buffer = g_realloc(ft->buffer, ft->size_max);
+	}
+	put = ft->buffer + ft->size;
+	memcpy(put, data, len);
+	ft->size += len;
+	for (end = put + len; put < end;)
+	{
+		gchar	*sep = memchr(put, separator, end - put);
 
-	return r;
+		if (sep > put)
+		{
+			if (ft->num_files == ft->max_files)
+			{
+				ft->max_files = ft->max_files == 0 ? 1024 : 2 * ft->max_files;
+				ft->offset = g_renew(guint32, ft->offset, ft->max_files);
+			}
+			ft->offset[ft->num_files++] = put - ft->buffer;
+		}
+		*sep = '\0';
+		put = sep + 1;
+	}
 }
 
-/* Returns the repository to which the given path belongs, or NULL if the path is not part of a repository. */
-Repository * repository_find_by_path(const gchar *path)
-{
-	GHashTableIter	iter;
-	gpointer	key, value;
+#define	file_table_get(ft, i)	((const gchar *) (ft)->buffer + (ft)->offset[i])
 
-	if (path == NULL)
-		return NULL;
+/* Returns the index of the first file that doesn't sort before <path>, using the fact that git lists files in
+ * (byte-wise) sorted order. All the files under a directory "dir/" are then the ones from "dir/" up to "dir0".
+*/
+guint32 file_table_lower_bound(const FileTable *ft, const gchar *path)
+{
+	guint32	lo = 0, hi = ft->num_files;
 
-	g_hash_table_iter_init(&iter, gitbrowser.repositories);
-	while (g_hash_table_iter_next(&iter, &key, &value))
+	while (lo < hi)
 	{
-		Repository	*repo = value;
+		const guint32	mid = (lo + hi) / 2;
 
-		if (strstr(path, repo->root_path) == path)
-			return repo;
+		if (strcmp(file_table_get(ft, mid), path) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	return NULL;
+	return lo;
 }
 
-static guint string_store(QuickOpenInfo *qoi, const gchar *text)
+/* Finds a file by its path. Returns its index, or -1. */
+gint32 file_table_find(const FileTable *ft, const gchar *path)
 {
-	gpointer	offset = g_hash_table_lookup(qoi->dedup, text);
+	const guint32	i = file_table_lower_bound(ft, path);
 
-	/* The first name is stored starting at 1, which makes NULL really represent "unknown name". */
-	if (offset == NULL)
-	{
-		offset = GUINT_TO_POINTER(qoi->names->len + 1);
+	return i < ft->num_files && strcmp(file_table_get(ft, i), path) == 0 ? (gint32) i : -1;
+}
 
-		g_string_append_c(qoi->names, '\0');	/* Terminate previous name. */
-		g_string_append(qoi->names, text);
-		/* Remember the offset at which this name starts, for de-duplicating. */
-		g_hash_table_insert(qoi->dedup, (gpointer) text, offset);
-	}
-	return GPOINTER_TO_UINT(offset);
+void file_tree_init(FileTree *tree)
+{
+	memset(tree, 0, sizeof *tree);
+	tree->max_nodes = 1024;
+	tree->nodes = g_new(FileNode, tree->max_nodes);
+	tree->nodes[0].name = tree->nodes[0].display = tree->nodes[0].parent = 0;
+	tree->nodes[0].first_child = tree->nodes[0].next_sibling = 0;
+	tree->num_nodes = 1;
+	tree->max_open = 16;
+	tree->open = g_new(guint32, tree->max_open);
+	tree->open_last = g_new(guint32, tree->max_open);
+	tree->open[0] = 0;
+	tree->open_last[0] = 0;
+	tree->num_open = 1;
 }
 
-static void recurse_repository_to_list(GtkTreeModel *model, GtkTreeIter *iter, gchar *path, gsize path_length, QuickOpenInfo *qoi)
+void file_tree_clear(FileTree *tree)
 {
-	gchar		*dname, *fname, *get, *put;
-	const gsize	old_length = path_length;
-	GtkTreeIter	child;
-	
-	/* Loop over all nodes at this level. */
-	do
-	{
-		gtk_tree_model_get(model, iter, 0, &dname, 1, &fname, -1);
-		/* Append the local filename to the path. Ignore buffer overflow, for now. */
-		for (get = fname, put = path + path_length; *get != '\0'; get++, put++, path_length++)
-			*put = *get;
-		*put = '\0';
+	g_free(tree->nodes);
+	g_free(tree->open);
+	g_free(tree->open_last);
+	g_free(tree->unsorted);
+	g_free(tree->names);
+	memset(tree, 0, sizeof *tree);
+}
 
-		/* Do we need to recurse, here? */
-		if (gtk_tree_model_iter_children(model, &child, iter))
-		{
-			/* Yes: time to iterate children, so append a separator. */
-			strcpy(put, G_DIR_SEPARATOR_S);
-			path_length += strlen(G_DIR_SEPARATOR_S);
+/* Compares two path components, each of which ends at a slash or a terminator. */
+static gint path_component_compare(const gchar *a, const gchar *b)
+{
+	for (; *a == *b && *a != '/' && *a != '\0'; a++, b++)
+		;
+	return (gint) (*a == '/' ? 0 : (guchar) *a) - (gint) (*b == '/' ? 0 : (guchar) *b);
+}
 
-			recurse_repository_to_list(model, &child, path, path_length, qoi);
-		}
-		else
+/* Appends a node for the component at <name> to the innermost open directory, and opens it if it's a directory too. */
+static void file_tree_append(FileTree *tree, const gchar *buffer, guint32 name, gboolean dir)
+{
+	const guint32	parent = tree->num_open - 1, node = tree->num_nodes;
+
+	if (tree->num_nodes == tree->max_nodes)
+	{
+		tree->max_nodes *= 2;
+		tree->nodes = g_renew(FileNode, tree->nodes, tree->max_nodes);
+	}
+	tree->nodes[node].name = name;
+	tree->nodes[node].display = 0;
+	tree->nodes[node].parent = tree->open[parent];
+	tree->nodes[node].first_child = tree->nodes[node].next_sibling = 0;
+	tree->num_nodes++;
+	if (tree->open_last[parent] == 0)
+		tree->nodes[tree->open[parent]].first_child = node;
+	else
+	{
+		tree->nodes[tree->open_last[parent]].next_sibling = node;
+		/* Git sorts on whole paths, so "a-b/" comes before "a/" although "a" sorts before "a-b". Rare, so fix it afterwards. */
+		if (path_component_compare(buffer + name, buffer + tree->nodes[tree->open_last[parent]].name) < 0 &&
+		    (tree->num_unsorted == 0 || tree->unsorted[tree->num_unsorted - 1] != tree->open[parent]))
 		{
-			if (gitbrowser.quick_open_hide == NULL || !g_regex_match(gitbrowser.quick_open_hide, dname, 0, NULL))
+			if (tree->num_unsorted == tree->max_unsorted)
 			{
-				gchar		*dname_lower, *dpath, *slash;
-				QuickOpenRow	row;
-
-				/* Append name and path to the big string buffer, putting "naked" offsets in the pointers. */
-				row.name = GSIZE_TO_POINTER(string_store(qoi, dname));
-				/* Convert to lower-case, and store that version too, for filtering. */
-				dname_lower = g_utf8_strdown(dname, -1);
-				row.name_lower = GSIZE_TO_POINTER(string_store(qoi, dname_lower));
-				/* Remove the last component, which is dname itself, and we don't want it in the Location column. */
-				dpath = g_filename_display_name(path);
-				if ((slash = g_utf8_strrchr(dpath, -1, G_DIR_SEPARATOR)) != NULL)
-					*slash = '\0';
-				row.path = GSIZE_TO_POINTER(string_store(qoi, dpath));
-				g_free(dpath);
-				g_array_append_val(qoi->array, row);
-				qoi->files_total++;
+				tree->max_unsorted = tree->max_unsorted == 0 ? 16 : 2 * tree->max_unsorted;
+				tree->unsorted = g_renew(guint32, tree->unsorted, tree->max_unsorted);
 			}
+			tree->unsorted[tree->num_unsorted++] = tree->open[parent];
+		}
+	}
+	tree->open_last[parent] = node;
+	if (dir)
+	{
+		if (tree->num_open == tree->max_open)
+		{
+			tree->max_open *= 2;
+			tree->open = g_renew(guint32, tree->open, tree->max_open);
+			tree->open_last = g_renew(guint32, tree->open_last, tree->max_open);
 		}
-		/* Undo our modifications to the global path. */
-		path[old_length] = '\0';
-		path_length = old_length;
-	} while (gtk_tree_model_iter_next(model, iter));
+		tree->open[tree->num_open] = node;
+		tree->open_last[tree->num_open++] = 0;
+	}
 }
 
-static void repository_to_list(const Repository *repo, GtkTreeModel *model, QuickOpenInfo *qoi)
+/* Adds the files from <first> on. Each path is compared against the open directories only, so this is linear in the
+ * length of the listing, however wide the directories are.
+*/
+void file_tree_add(FileTree *tree, const FileTable *files, guint32 first)
 {
-	GtkTreeIter	root, iter;
-	gboolean	found = FALSE;
-	gchar		buf[2048];
-	gsize		len;
-
-	if (!gtk_tree_model_get_iter_first(model, &root) || !gtk_tree_model_iter_children(model, &iter, &root))
-		return;
-	/* Walk the toplevel nodes, which should be very very few, looking for the given repository.
-	 * This seems a bit clumsy, but it's a trade-off between i.e. maintaining an iter to the repo
-	 * at all times (which is annoying when repos are added/moved/deleted) and this. This won.
-	*/
-	do
-	{
-		gchar	*path;
-
-		gtk_tree_model_get(model, &iter, 1, &path, -1);
-		if (path != NULL)	/* Separators have a NULL root path. That's what they are. */
-			found = strcmp(path, repo->root_path) == 0;
-		g_free(path);
-	} while (!found && gtk_tree_model_iter_next(model, &iter));
-	if (!found)
-		return;
-	/* Now 'iter' is the root of the repository we want to linearize. */
-	root = iter;
-	if (!gtk_tree_model_iter_children(model, &iter, &root))
-		return;
-	/* Now 'iter' is finally pointing at the repository's first file. */
-	len = g_snprintf(buf, sizeof buf, "%s%s", repo->root_path, G_DIR_SEPARATOR_S);
-	if (len < sizeof buf)
+	for (guint32 i = first; i < files->num_files; i++)
 	{
-		GTimer	*tmr = g_timer_new();
-		LDState	lstate;
+		const gchar	*path = file_table_get(files, i), *slash;
+		guint32		depth = 1;
 
-		/* Be prepared for being re-run on the same repository, so clear data first. */
-		qoi->files_total = qoi->files_filtered = 0;
-		g_string_truncate(qoi->names, 0);
-		gtk_list_store_clear(qoi->store);
-		qoi->dedup = g_hash_table_new(g_str_hash, g_str_equal);
-		qoi->array = g_array_new(FALSE, FALSE, sizeof (QuickOpenRow));
-		recurse_repository_to_list(model, &iter, buf, len, qoi);
-		levenshtein_begin_half(&lstate, qoi->filter_text);
-		/* Now we need to fixup; convert stored offsets into actual absolute memory addresses. */
-		for (gsize i = 0; i < qoi->files_total; i++)
-		{
-			QuickOpenRow	*row = &g_array_index(qoi->array, QuickOpenRow, i);
-
-			row->name = qoi->names->str + GPOINTER_TO_SIZE(row->name);
-			row->name_lower = qoi->names->str + GPOINTER_TO_SIZE(row->name_lower);
-			row->path = qoi->names->str + GPOINTER_TO_SIZE(row->path);
-			row->distance = levenshtein_compute_half(&lstate, row->name);
-		}
-		levenshtein_end(&lstate);
-		/* Finally, use the array to populate the list store. */
-		for (gsize i = 0; i < qoi->files_total; i++)
+		/* Keep the directories this file shares with the previous one, close the rest. */
+		while ((slash = strchr(path, '/')) != NULL && depth < tree->num_open &&
+		       path_component_compare(path, files->buffer + tree->nodes[tree->open[depth]].name) == 0)
 		{
-			const QuickOpenRow	*row = &g_array_index(qoi->array, QuickOpenRow, i);
-			gtk_list_store_insert_with_values(qoi->store, &iter, INT_MAX, QO_NAME, row->name, QO_NAME_LOWER, row->name_lower, QO_PATH, row->path, QO_VISIBLE, TRUE, -1);
+			path = slash + 1;
+			depth++;
 		}
-		/* We no longer need the array, so throw it away. */
-		g_array_free(qoi->array, TRUE);
-		g_hash_table_destroy(qoi->dedup);
-		g_timer_destroy(tmr);
+		tree->num_open = depth;
+		for (; (slash = strchr(path, '/')) != NULL; path = slash + 1)
+			file_tree_append(tree, files->buffer, path - files->buffer, TRUE);
+		file_tree_append(tree, files->buffer, path - files->buffer, FALSE);
 	}
 }
 
-void repository_save_all(GtkTreeModel *model)
+static gint cb_file_tree_compare(gconstpointer a, gconstpointer b, gpointer user)
 {
-	GtkTreeIter	root, iter;
-	GString		*repos = NULL;
-	GKeyFile	*out;
-	gchar		*data;
+	const FileTree	*tree = ((gconstpointer *) user)[0];
+	const gchar	*buffer = ((gconstpointer *) user)[1];
 
-	if (gtk_tree_model_get_iter_first(model, &root) && gtk_tree_model_iter_children(model, &iter, &root))
-	{
-		repos = g_string_new("");
-		do
-		{
-			gchar	*dpath, *fn;
+	return path_component_compare(buffer + tree->nodes[*(const guint32 *) a].name, buffer + tree->nodes[*(const guint32 *) b].name);
+}
 
-			gtk_tree_model_get(model, &iter, 1, &dpath, -1);
-			if (dpath == NULL)
-			{
-				if (repos->len > 0)
-					g_string_append_c(repos, PATH_SEPARATOR_CHAR);
-				g_string_append(repos, REPO_IS_SEPARATOR);
-			}
-			else
-			{
-				if ((fn = g_filename_from_utf8(dpath, -1, NULL, NULL, NULL)) != NULL)
-				{
-					if (repos->len > 0)
-						g_string_append_c(repos, PATH_SEPARATOR_CHAR);
-					g_string_append(repos, fn);
-					g_free(fn);
-				}
-			}
-			g_free(dpath);
-		} while (gtk_tree_model_iter_next(model, &iter));
+/* Adds a display name for <node> to the tree's names. */
+static void file_tree_set_display(FileTree *tree, guint32 node, const gchar *name, gsize len)
+{
+	if (tree->names_size + len + 1 > tree->names_max)
+	{
+		tree->names_max = MAX(2 * tree->names_max, tree->names_size + len + 1 + 4096);
+		tree->names = g_realloc(tree->names, tree->names_max);
 	}
+	memcpy(tree->names + tree->names_size, name, len);
+	tree->names[tree->names_size + len] = '\0';
+	tree->nodes[node].display = tree->names_size + 1;
+	tree->names_size += len + 1;
+}
 
-	out = g_key_file_new();
+/* Numbers the nodes over again, breadth-first, so each directory's children get consecutive numbers in the order they're
+ * linked. Then a node's position among its siblings is how far it is from the first, and the n:th child is found by adding.
+*/
+static void file_tree_renumber(FileTree *tree)
+{
+	guint32		*renumbered = g_new(guint32, tree->num_nodes), *order = g_new(guint32, tree->num_nodes), count = 1;
+	FileNode	*nodes = g_new(FileNode, tree->max_nodes);
 
-	if (repos != NULL)
+	renumbered[0] = order[0] = 0;
+	for (guint32 i = 0; i < count; i++)
 	{
-		GString	*exp = tree_view_get_expanded(GTK_TREE_VIEW(gitbrowser.view));
-
-		g_key_file_set_string(out, MNEMONIC_NAME, CFG_REPOSITORIES, repos->str);
-		g_string_free(repos, TRUE);
-		if (exp != NULL)
+		for (guint32 child = tree->nodes[order[i]].first_child; child != 0; child = tree->nodes[child].next_sibling)
 		{
-			if (exp->len > 0)
-				g_key_file_set_string(out, MNEMONIC_NAME, CFG_EXPANDED, exp->str);
-			g_string_free(exp, TRUE);
+			renumbered[child] = count;
+			order[count++] = child;
 		}
 	}
-	stash_group_save_to_key_file(gitbrowser.prefs, out);
-
-	if ((data = g_key_file_to_data(out, NULL, NULL)) != NULL)
+	for (guint32 i = 0; i < count; i++)
 	{
-		utils_write_file(gitbrowser.config_filename, data);
-		g_free(data);
+		const FileNode	*old = tree->nodes + order[i];
+
+		nodes[i] = *old;
+		nodes[i].parent = renumbered[old->parent];
+		nodes[i].first_child = old->first_child != 0 ? renumbered[old->first_child] : 0;
+		nodes[i].next_sibling = old->next_sibling != 0 ? renumbered[old->next_sibling] : 0;
 	}
-	g_key_file_free(out);
+	g_free(tree->nodes);
+	tree->nodes = nodes;
+	tree->num_nodes = count;
+	tree->contiguous = TRUE;
+	g_free(order);
+	g_free(renumbered);
 }
 
-void repository_load_all(void)
+/* Finishes the tree once all files are in. The children of the directories that need it are put in strcmp() order, and
+ * then each directory's children are re-linked to have the directories first, which is how the sidebar shows them. The
+ * display names are worked out too; for most files that's the component in the file table itself, so only directories
+ * (whose components end at a slash) and the odd name that isn't in UTF-8 need one of their own. Last, the nodes are
+ * renumbered so the sidebar can find rows by position directly.
+*/
+void file_tree_finish(FileTree *tree, const gchar *buffer)
 {
-	GKeyFile	*in;
+	gconstpointer	user[] = { tree, buffer };
+	GArray		*children = g_array_new(FALSE, FALSE, sizeof (guint32));
+	const gboolean	utf8 = g_get_filename_charsets(NULL);
 
-	in = g_key_file_new();
-	if (g_key_file_load_from_file(in, gitbrowser.config_filename, G_KEY_FILE_NONE, NULL))
+	for (guint32 i = 0; i < tree->num_unsorted; i++)
 	{
-		gchar	*str;
+		FileNode	*dir = tree->nodes + tree->unsorted[i];
+
+		g_array_set_size(children, 0);
+		for (guint32 child = dir->first_child; child != 0; child = tree->nodes[child].next_sibling)
+			g_array_append_val(children, child);
+		g_qsort_with_data(children->data, children->len, sizeof (guint32), cb_file_tree_compare, user);
+		dir->first_child = g_array_index(children, guint32, 0);
+		for (guint32 j = 0; j < children->len; j++)
+			tree->nodes[g_array_index(children, guint32, j)].next_sibling = j + 1 < children->len ? g_array_index(children, guint32, j + 1) : 0;
+	}
+	g_array_free(children, TRUE);
+	tree->num_unsorted = 0;
 
-		if ((str = g_key_file_get_string(in, MNEMONIC_NAME, CFG_REPOSITORIES, NULL)) != NULL)
+	for (guint32 i = 0; i < tree->num_nodes; i++)
+	{
+		FileNode	*node = tree->nodes + i;
+		guint32		dirs = 0, files = 0, dirs_last = 0, files_last = 0;
+
+		if (i > 0)
 		{
-			gchar	separator[] = { PATH_SEPARATOR_CHAR, '\0' };
-			gchar	**repo_vector = g_strsplit(str, separator, 0);
-			gchar	*exp;
+			const gchar	*name = buffer + node->name;
+			const gsize	len = strcspn(name, "/");
 
-			for (gsize i = 0; repo_vector[i] != NULL; i++)
+			if (!utf8 || !g_utf8_validate(name, len, NULL))
 			{
-				if (strcmp(repo_vector[i], REPO_IS_SEPARATOR) == 0)
-					tree_model_build_separator(gitbrowser.model);
-				else
-				{
-					Repository	*repo = repository_new(repo_vector[i]);
-					tree_model_build_repository(gitbrowser.model, NULL, repo->root_path);
-				}
+				gchar	*raw = g_strndup(name, len), *display = g_filename_display_name(raw);
+
+				file_tree_set_display(tree, i, display, strlen(display));
+				g_free(display);
+				g_free(raw);
 			}
-			g_free(str);
-			exp = g_key_file_get_string(in, MNEMONIC_NAME, CFG_EXPANDED, NULL);
-			/* Note: Both of these calls do the right thing even if exp == NULL. */
-			tree_view_set_expanded(GTK_TREE_VIEW(gitbrowser.view), exp);
-			g_free(exp);
+			else if (name[len] != '\0')
+				file_tree_set_display(tree, i, name, len);
 		}
+		if (node->first_child == 0)
+			continue;
+		/* Split the children into two lists, keeping the order within each, and put the directories' in front. */
+		for (guint32 child = node->first_child, next; child != 0; child = next)
+		{
+			next = tree->nodes[child].next_sibling;
+			tree->nodes[child].next_sibling = 0;
+			if (tree->nodes[child].first_child != 0)
+			{
+				if (dirs_last == 0)
+					dirs = child;
+				else
+					tree->nodes[dirs_last].next_sibling = child;
+				dirs_last = child;
+			}
+			else
+			{
+				if (files_last == 0)
+					files = child;
+				else
+					tree->nodes[files_last].next_sibling = child;
+				files_last = child;
+			}
+		}
+		if (dirs_last != 0)
+			tree->nodes[dirs_last].next_sibling = files;
+		node->first_child = dirs != 0 ? dirs : files;
 	}
-	stash_group_load_from_key_file(gitbrowser.prefs, in);
-	open_quick_reset_filter();
+	file_tree_renumber(tree);
+}
 
-	g_key_file_free(in);
+/* Returns the name to show for a node, which doesn't need freeing. */
+static const gchar * file_tree_get_display(const FileTree *tree, const gchar *buffer, guint32 node)
+{
+	const FileNode	*n = tree->nodes + node;
+
+	return n->display != 0 ? tree->names + n->display - 1 : buffer + n->name;
 }
 
-static void evt_open_quick_selection_changed(GtkTreeSelection *sel, gpointer user)
+/* Compares nodes the way siblings are ordered: directories first, then by name. The two can be in different trees. */
+static gint file_node_compare(const FileTree *ta, const gchar *ba, guint32 a, const FileTree *tb, const gchar *bb, guint32 b)
 {
-	QuickOpenInfo	*qoi = user;
+	const gboolean	a_dir = ta->nodes[a].first_child != 0, b_dir = tb->nodes[b].first_child != 0;
 
-	gtk_dialog_set_response_sensitive(GTK_DIALOG(qoi->dialog), GTK_RESPONSE_OK, gtk_tree_selection_count_selected_rows(sel) > 0);
+	if (a_dir != b_dir)
+		return a_dir ? -1 : 1;
+	return path_component_compare(ba + ta->nodes[a].name, bb + tb->nodes[b].name);
 }
 
-static void evt_open_quick_view_row_activated(GtkWidget *view, GtkTreePath *path, GtkTreeViewColumn *column, gpointer user)
+/* Copies <node> and everything below it from another tree, whose components are in <buffer>, into <tree> under <parent>.
+ * The copied components go at the end of <files>' buffer, terminated, but aren't added as files. The copy is returned,
+ * for the caller to link in among its siblings.
+*/
+static guint32 file_tree_graft(FileTree *tree, FileTable *files, guint32 parent, const FileTree *from, const gchar *buffer, guint32 node)
 {
-	QuickOpenInfo	*qoi = user;
+	const FileNode	*src = from->nodes + node;
+	const gchar	*name = buffer + src->name;
+	const gsize	len = strcspn(name, "/");
+	const guint32	copy = tree->num_nodes;
+	guint32		last = 0;
 
-	gtk_dialog_response(GTK_DIALOG(qoi->dialog), GTK_RESPONSE_OK);
+	if (tree->num_nodes == tree->max_nodes)
+	{
+		tree->max_nodes *= 2;
+		tree->nodes = g_renew(FileNode, tree->nodes, tree->max_nodes);
+	}
+	if (files->size + len + 1 > files->size_max)
+	{
+		files->size_max = MAX(2 * files->size_max, files->size + len + 1);
+		files->buffer = g_realloc(files->buffer, files->size_max);
+	}
+	memcpy(files->buffer + files->size, name, len);
+	files->buffer[files->size + len] = '\0';
+	tree->nodes[copy].name = files->size;
+	tree->nodes[copy].display = 0;
+	tree->nodes[copy].parent = parent;
+	tree->nodes[copy].first_child = tree->nodes[copy].next_sibling = 0;
+	tree->num_nodes++;
+	files->size += len + 1;
+	if (src->display != 0)
+		file_tree_set_display(tree, copy, from->names + src->display - 1, strlen(from->names + src->display - 1));
+
+	for (guint32 child = src->first_child; child != 0; child = from->nodes[child].next_sibling)
+	{
+		const guint32	c = file_tree_graft(tree, files, copy, from, buffer, child);
+
+		if (last == 0)
+			tree->nodes[copy].first_child = c;
+		else
+			tree->nodes[last].next_sibling = c;
+		last = c;
+	}
+	return copy;
 }
 
-static void open_quick_update_label(QuickOpenInfo *qoi)
+/* -------------------------------------------------------------------------------------------------------------- */
+
+Repository * repository_new(const gchar *root_path)
+{
+	Repository	*r = g_malloc(sizeof *r);
+
+	g_strlcpy(r->root_path, root_path, sizeof r->root_path);
+	r->git_dir = NULL;
+
+	memset(&r->files, 0, sizeof r->files);
+	memset(&r->tree, 0, sizeof r->tree);
+	r->list_build = NULL;
+	r->quick_open = NULL;
+	r->quick_open_rows = NULL;
+	r->quick_open_tracked = 0;
+	r->quick_open_used = 0;
+	r->recency = NULL;
+	r->recency_head[0] = '\0';
+	r->recency_build = NULL;
+	r->untracked = NULL;
+	r->symbols = NULL;
+	r->symbols_build = NULL;
+	r->watch[0] = r->watch[1] = NULL;
+	r->watch_quiet = 0;
+
+	g_hash_table_insert(gitbrowser.repositories, r->root_path, r);
+
+	return r;
+}
+
+/* Forgets all about a repository, and frees it. The caller is responsible for the tree model. */
+void repository_free(Repository *repo)
+{
+	repository_list_cancel(repo);
+	repository_list_settle();
+	repository_watch_stop(repo);
+	repository_drop_quick_open(repo);
+	if (repo->recency != NULL)
+		g_hash_table_destroy(repo->recency);
+	file_tree_clear(&repo->tree);
+	file_table_clear(&repo->files);
+	g_hash_table_remove(gitbrowser.repositories, repo->root_path);
+	g_free(repo->git_dir);
+	g_free(repo);
+}
+
+/* Frees every known repository. */
+static void repository_free_all(void)
+{
+	GList	*repos, *iter;
+
+	if ((repos = g_hash_table_get_values(gitbrowser.repositories)) != NULL)
+	{
+		for (iter = repos; iter != NULL; iter = g_list_next(iter))
+			repository_free(iter->data);
+		g_list_free(repos);
+	}
+}
+
+/* Returns the repository to which the given path belongs, or NULL if the path is not part of a repository. */
+Repository * repository_find_by_path(const gchar *path)
+{
+	GHashTableIter	iter;
+	gpointer	key, value;
+
+	if (path == NULL)
+		return NULL;
+
+	g_hash_table_iter_init(&iter, gitbrowser.repositories);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		Repository	*repo = value;
+
+		if (strstr(path, repo->root_path) == path)
+			return repo;
+	}
+	return NULL;
+}
+
+/* Returns the repository's name, i.e. the last component of its root path. */
+const gchar * repository_get_name(const Repository *repo)
 {
-	gchar	buf[64];
+	const gchar	*slash = strrchr(repo->root_path, G_DIR_SEPARATOR);
+
+	return slash != NULL ? slash + 1 : repo->root_path;
+}
 
-	if (qoi->files_filtered == 0)
-		g_snprintf(buf, sizeof buf, _("Showing all %lu files."), qoi->files_total);
+/* Formats the repository's label for the sidebar, its name and the branch (if not empty) it's on, into <buf>. */
+const gchar * repository_get_label(const Repository *repo, const gchar *branch, gchar *buf, gsize buf_max)
+{
+	if (branch[0] != '\0')
+		g_snprintf(buf, buf_max, "%s [%s]", repository_get_name(repo), branch);
 	else
-		g_snprintf(buf, sizeof buf, _("Showing %lu/%lu files."), qoi->files_total - qoi->files_filtered, qoi->files_total);
-	gtk_label_set_text(GTK_LABEL(qoi->label), buf);
+		g_strlcpy(buf, repository_get_name(repo), buf_max);
+	return buf;
 }
 
-static gboolean cb_open_quick_filter_idle(gpointer user)
+static QuickOpenIndex * open_quick_index_new(gboolean symbols)
 {
-	QuickOpenInfo	*qoi = user;
-	GtkTreeIter	iter;
-	GtkTreePath	*first;
-	gboolean	valid = TRUE;
-	GTimer		*tmr;
-	const gdouble	max_time = 1e-3 * gitbrowser.quick_open_filter_max_time;
+	QuickOpenIndex	*idx = g_malloc(sizeof *idx);
+
+	strtab_init(&idx->names);
+	idx->rows = 0;
+	idx->rows_max = 1024;
+	idx->name = g_new(guint32, idx->rows_max);
+	idx->name_lower = g_new(guint32, idx->rows_max);
+	idx->path = g_new(guint32, idx->rows_max);
+	idx->distance = g_new(guint16, idx->rows_max);
+	idx->visible = g_new(guint32, BITSET_WORDS(idx->rows_max));
+	idx->dead = g_new0(guint32, BITSET_WORDS(idx->rows_max));
+	idx->free_rows = NULL;
+	idx->num_free = 0;
+	idx->max_free = 0;
+	idx->file = symbols ? g_new(guint32, idx->rows_max) : NULL;
+	idx->line = symbols ? g_new(guint32, idx->rows_max) : NULL;
+	idx->recency = symbols ? NULL : g_new(guint8, idx->rows_max);
+	idx->recent = NULL;
+	idx->num_recent = 0;
+	idx->extensions = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) roaring_free);
+
+	return idx;
+}
+
+static void open_quick_index_destroy(QuickOpenIndex *idx)
+{
+	strtab_destroy(&idx->names);
+	g_free(idx->name);
+	g_free(idx->name_lower);
+	g_free(idx->path);
+	g_free(idx->distance);
+	g_free(idx->visible);
+	g_free(idx->dead);
+	g_free(idx->free_rows);
+	g_free(idx->file);
+	g_free(idx->line);
+	g_free(idx->recency);
+	g_free(idx->recent);
+	g_hash_table_destroy(idx->extensions);
+	g_free(idx);
+}
+
+/* Returns the number of bytes of heap memory used by the index. */
+static gsize open_quick_index_memory(const QuickOpenIndex *idx)
+{
+	const gsize	per_row = sizeof *idx->name + sizeof *idx->name_lower + sizeof *idx->path + sizeof *idx->distance +
+				(idx->line != NULL ? sizeof *idx->file + sizeof *idx->line : 0) + (idx->recency != NULL ? sizeof *idx->recency : 0);
+	gsize		size = sizeof *idx + strtab_memory(&idx->names) + idx->rows_max * per_row + 2 * BITSET_WORDS(idx->rows_max) * sizeof *idx->visible +
+				idx->max_free * sizeof *idx->free_rows + idx->num_recent * sizeof *idx->recent;
+	GHashTableIter	iter;
+	gpointer	value;
+
+	g_hash_table_iter_init(&iter, idx->extensions);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		size += roaring_memory(value);
+	return size;
+}
+
+/* Returns the bitmap of rows whose file name has the same extension as <filename>, creating it if needed. NULL if there's no extension. */
+static RoaringBitmap * open_quick_index_extension(QuickOpenIndex *idx, const gchar *filename)
+{
+	const gchar	*dot = strrchr(filename, '.'), *ext;
+	RoaringBitmap	*rows;
+
+	/* Names like ".gitignore" are all extension, and don't count. */
+	if (dot == NULL || dot == filename || dot[1] == '\0')
+		return NULL;
+	ext = strtab_get(&idx->names, strtab_intern_lower(&idx->names, dot + 1, -1));
+	if ((rows = g_hash_table_lookup(idx->extensions, ext)) == NULL)
+	{
+		rows = roaring_new();
+		g_hash_table_insert(idx->extensions, (gpointer) ext, rows);
+	}
+	return rows;
+}
+
+/* Marks a row as dead, its file is gone. The row's strings stay in the string table, and it's kept around for re-use. */
+static void open_quick_index_remove(QuickOpenIndex *idx, guint32 row)
+{
+	RoaringBitmap	*ext = open_quick_index_extension(idx, strtab_get(&idx->names, idx->name[row]));
+
+	if (ext != NULL)
+		roaring_remove(ext, row);
+	BITSET_CLEAR(idx->visible, row);
+	BITSET_SET(idx->dead, row);
+	if (idx->num_free == idx->max_free)
+	{
+		idx->max_free = idx->max_free == 0 ? 64 : 2 * idx->max_free;
+		idx->free_rows = g_renew(guint32, idx->free_rows, idx->max_free);
+	}
+	idx->free_rows[idx->num_free++] = row;
+}
+
+/* Returns the number of live rows, i.e. files actually in the list. */
+#define	open_quick_index_size(idx)	((idx)->rows - (idx)->num_free)
+
+/* Appends a file, located in the directory whose (display) name is <dir>. Returns the new row's number.
+ * A dead row is re-used if there is one, so this only ever appends to lists that never had files removed.
+*/
+static guint32 open_quick_index_append(QuickOpenIndex *idx, const gchar *name, gsize name_len, guint32 dir)
+{
+	guint32	row = idx->rows;
+
+	if (idx->num_free > 0)
+	{
+		row = idx->free_rows[--idx->num_free];
+		BITSET_CLEAR(idx->dead, row);
+		idx->rows--;	/* Cancels out the increment below. */
+	}
+	else if (row == idx->rows_max)
+	{
+		idx->rows_max *= 2;
+		idx->name = g_renew(guint32, idx->name, idx->rows_max);
+		idx->name_lower = g_renew(guint32, idx->name_lower, idx->rows_max);
+		idx->path = g_renew(guint32, idx->path, idx->rows_max);
+		idx->distance = g_renew(guint16, idx->distance, idx->rows_max);
+		idx->visible = g_renew(guint32, idx->visible, BITSET_WORDS(idx->rows_max));
+		idx->dead = g_renew(guint32, idx->dead, BITSET_WORDS(idx->rows_max));
+		memset(idx->dead + BITSET_WORDS(row), 0, (BITSET_WORDS(idx->rows_max) - BITSET_WORDS(row)) * sizeof *idx->dead);
+		if (idx->line != NULL)
+		{
+			idx->file = g_renew(guint32, idx->file, idx->rows_max);
+			idx->line = g_renew(guint32, idx->line, idx->rows_max);
+		}
+		if (idx->recency != NULL)
+			idx->recency = g_renew(guint8, idx->recency, idx->rows_max);
+	}
+	idx->name[row] = strtab_intern(&idx->names, name, name_len);
+	idx->name_lower[row] = strtab_intern_lower(&idx->names, name, name_len);
+	idx->path[row] = dir;
+	idx->distance[row] = 0;
+	if (idx->recency != NULL)
+		idx->recency[row] = 0;
+	BITSET_SET(idx->visible, row);
+	idx->rows++;
+	return row;
+}
+
+/* Remembers the directory of the last path appended, since consecutive paths from git tend to share it. */
+typedef struct {
+	const gchar	*dir;
+	gsize		dir_len;
+	guint32		dir_id;
+} QuickOpenDirCache;
+
+/* Appends a file, given by its '/'-separated path relative to the repository root, to a Quick Open list.
+ * The display name of its directory is only re-computed when it differs from that of the previous file.
+*/
+static guint32 open_quick_index_append_path(QuickOpenIndex *idx, const gchar *root_path, const gchar *path, QuickOpenDirCache *cache)
+{
+	const gchar	*slash = strrchr(path, '/'), *name = slash != NULL ? slash + 1 : path;
+	const gsize	dir_len = slash != NULL ? (gsize) (slash - path) : 0;
+	gchar		*disp;
+	guint32		row = QO_NO_ROW;
+
+	if (cache->dir_id == 0 || dir_len != cache->dir_len || strncmp(path, cache->dir, dir_len) != 0)
+	{
+		gchar	*fs = g_strdup_printf("%s%s%.*s", root_path, slash != NULL ? G_DIR_SEPARATOR_S : "", (int) dir_len, path);
+
+		g_strdelimit(fs, "/", G_DIR_SEPARATOR);
+		disp = g_filename_display_name(fs);
+		cache->dir_id = strtab_intern(&idx->names, disp, -1);
+		g_free(disp);
+		g_free(fs);
+		cache->dir = path;
+		cache->dir_len = dir_len;
+	}
+	disp = g_filename_display_name(name);
+	if (gitbrowser.quick_open_hide == NULL || !g_regex_match(gitbrowser.quick_open_hide, disp, 0, NULL))
+	{
+		RoaringBitmap	*ext = open_quick_index_extension(idx, disp);
+
+		row = open_quick_index_append(idx, disp, strlen(disp), cache->dir_id);
+		if (ext != NULL)
+			roaring_add(ext, row);
+	}
+	g_free(disp);
+	return row;
+}
+
+/* Builds a repository's Quick Open list from its file table. This doesn't touch the sidebar's tree model. */
+static void repository_to_list(Repository *repo, QuickOpenIndex *idx)
+{
+	GTimer			*tmr = g_timer_new();
+	QuickOpenDirCache	cache = { NULL, 0, 0 };
+
+	repo->quick_open_rows = g_renew(guint32, repo->quick_open_rows, repo->files.num_files);
+	for (guint32 i = 0; i < repo->files.num_files; i++)
+		repo->quick_open_rows[i] = open_quick_index_append_path(idx, repo->root_path, file_table_get(&repo->files, i), &cache);
+	repo->quick_open_tracked = idx->rows;
+	msgwin_status_add(_("Built Quick Open list for \"%s\"; %lu files in %.1f ms, using %lu KB."), repository_get_name(repo),
+			(unsigned long) idx->rows, 1e3 * g_timer_elapsed(tmr, NULL), (unsigned long) (open_quick_index_memory(idx) >> 10));
+	g_timer_destroy(tmr);
+}
+
+/* Throws away a repository's symbols, stopping any build of them. They're found again when next needed. */
+static void repository_drop_symbols(Repository *repo)
+{
+	if (repo->symbols_build != NULL)
+	{
+		symbol_build_cancel(repo->symbols_build);
+		repo->symbols_build = NULL;
+	}
+	if (repo->symbols != NULL)
+	{
+		if (gitbrowser.quick_open.index == repo->symbols)
+			open_quick_detach(&gitbrowser.quick_open);
+		open_quick_index_destroy(repo->symbols);
+		repo->symbols = NULL;
+	}
+}
+
+/* Throws away a repository's Quick Open list. It will be re-built when next needed. */
+static void repository_drop_quick_open(Repository *repo)
+{
+	if (repo->untracked != NULL)
+	{
+		subprocess_stream_cancel(repo->untracked);
+		repo->untracked = NULL;
+	}
+	repository_drop_symbols(repo);
+	repository_recency_cancel(repo);
+	if (gitbrowser.quick_open.repo == repo)
+		open_quick_detach(&gitbrowser.quick_open);
+	if (repo->quick_open != NULL)
+	{
+		open_quick_index_destroy(repo->quick_open);
+		repo->quick_open = NULL;
+	}
+	g_free(repo->quick_open_rows);
+	repo->quick_open_rows = NULL;
+	repo->quick_open_tracked = 0;
+}
+
+/* Brings a repository's Quick Open list up to date after its file table was re-listed, given the <old> table.
+ * Both tables are in git's (byte-wise sorted) order, so one merging pass finds the files removed and added.
+ * Only those rows are touched; everything about the other files stays as it was, including how they filtered.
+ * Returns FALSE if the list couldn't be updated, and should be dropped instead.
+*/
+static gboolean repository_update_quick_open(Repository *repo, const FileTable *old)
+{
+	const FileTable		*new = &repo->files;
+	QuickOpenIndex		*idx = repo->quick_open;
+	QuickOpenInfo		*qoi = &gitbrowser.quick_open;
+	QuickOpenDirCache	cache = { NULL, 0, 0 };
+	GArray			*added;
+	guint32			*rows, i = 0, j = 0, removed = 0;
+	GTimer			*tmr;
+
+	if (idx == NULL)
+		return TRUE;
+	/* Untracked files aren't in the file table, and any of them may have become tracked. Simpler to start over. */
+	if ((repo->quick_open_rows == NULL && old->num_files > 0) || gitbrowser.quick_open_untracked || new->buffer == NULL)
+		return FALSE;
+	tmr = g_timer_new();
+	rows = g_new(guint32, new->num_files);
+	added = g_array_new(FALSE, FALSE, sizeof (guint32));
+	while (i < old->num_files || j < new->num_files)
+	{
+		const gint	rel = i == old->num_files ? 1 : j == new->num_files ? -1 : strcmp(file_table_get(old, i), file_table_get(new, j));
+
+		if (rel == 0)
+			rows[j++] = repo->quick_open_rows[i++];
+		else if (rel < 0)
+		{
+			const guint32	row = repo->quick_open_rows[i];
+
+			if (row != QO_NO_ROW)
+			{
+				/* Dead rows don't count as filtered, so stop counting this one if it was. */
+				if (qoi->index == idx && !BITSET_TEST(idx->visible, row))
+					qoi->files_filtered--;
+				open_quick_index_remove(idx, row);
+			}
+			i++;
+			removed++;
+		}
+		else
+			g_array_append_val(added, j), j++;
+	}
+	/* Removals first, so the added files can re-use their rows. The added rows replace the file numbers in 'added'. */
+	for (guint32 k = 0; k < added->len; k++)
+	{
+		const guint32	at = g_array_index(added, guint32, k);
+
+		rows[at] = open_quick_index_append_path(idx, repo->root_path, file_table_get(new, at), &cache);
+		g_array_index(added, guint32, k) = rows[at];
+	}
+	g_free(repo->quick_open_rows);
+	repo->quick_open_rows = rows;
+	repo->quick_open_tracked = idx->rows;
+	msgwin_status_add(_("Updated Quick Open list for \"%s\"; %u files added and %u removed in %.1f ms."), repository_get_name(repo),
+			added->len, removed, 1e3 * g_timer_elapsed(tmr, NULL));
+	g_timer_destroy(tmr);
+
+	/* The dialog is modal so it's not showing, but it may still be attached to the list. If so, filter the new rows. */
+	if (qoi->index == idx)
+	{
+		guint32	num_rows = 0;
+
+		for (guint32 k = 0; k < added->len; k++)
+		{
+			if (g_array_index(added, guint32, k) != QO_NO_ROW)
+				g_array_index(added, guint32, num_rows++) = g_array_index(added, guint32, k);
+		}
+		open_quick_rows_changed(qoi, (const guint32 *) added->data, num_rows);
+	}
+	g_array_free(added, TRUE);
+	/* The symbols were found in the old files, those are easier to find again. */
+	repository_drop_symbols(repo);
+	/* There may be new commits, and added files need their recency. If HEAD hasn't moved, this is quick. */
+	repository_recency_start(repo);
+	open_quick_enforce_budget(repo);
+	return TRUE;
+}
+
+/* Returns the memory used by a repository's Quick Open lists, files and symbols together. */
+static gsize repository_quick_open_memory(const Repository *repo)
+{
+	return (repo->quick_open != NULL ? open_quick_index_memory(repo->quick_open) + repo->files.num_files * sizeof *repo->quick_open_rows : 0) +
+		(repo->symbols != NULL ? open_quick_index_memory(repo->symbols) : 0);
+}
+
+/* Drops the least recently used Quick Open lists until the total memory used is within budget. Never drops <keep>'s. */
+static void open_quick_enforce_budget(const Repository *keep)
+{
+	const gsize	budget = (gsize) gitbrowser.quick_open_memory_budget << 20;
+
+	for (;;)
+	{
+		GHashTableIter	iter;
+		gpointer	value;
+		Repository	*oldest = NULL;
+		gsize		total = 0;
+
+		g_hash_table_iter_init(&iter, gitbrowser.repositories);
+		while (g_hash_table_iter_next(&iter, NULL, &value))
+		{
+			Repository	*repo = value;
+
+			if (repo->quick_open == NULL && repo->symbols == NULL)
+				continue;
+			total += repository_quick_open_memory(repo);
+			if (repo != keep && (oldest == NULL || repo->quick_open_used < oldest->quick_open_used))
+				oldest = repo;
+		}
+		if (total <= budget || oldest == NULL)
+			break;
+		msgwin_status_add(_("Dropped Quick Open list for \"%s\" (%lu KB), to stay within the memory budget."), repository_get_name(oldest),
+				(unsigned long) (repository_quick_open_memory(oldest) >> 10));
+		repository_drop_quick_open(oldest);
+	}
+}
+
+/* Appends a chunk of NUL-terminated paths from 'git ls-files -z --others' to the repository's Quick Open list. */
+static void cb_repository_untracked_records(gchar *data, gsize len, gpointer user)
+{
+	Repository		*repo = user;
+	QuickOpenIndex		*idx = repo->quick_open;
+	const guint32		first = idx->rows;
+	QuickOpenDirCache	cache = { NULL, 0, 0 };
+
+	for (const gchar *line = data; line < data + len; line += strlen(line) + 1)
+		open_quick_index_append_path(idx, repo->root_path, line, &cache);
+	if (gitbrowser.quick_open.index == idx)
+		open_quick_rows_added(&gitbrowser.quick_open, first);
+}
+
+static void cb_repository_untracked_done(gboolean success, gpointer user)
+{
+	Repository	*repo = user;
+
+	repo->untracked = NULL;
+	msgwin_status_add(_("Listed untracked files in \"%s\"; Quick Open now has %lu files, using %lu KB."), repository_get_name(repo),
+			(unsigned long) repo->quick_open->rows, (unsigned long) (open_quick_index_memory(repo->quick_open) >> 10));
+	open_quick_enforce_budget(repo);
+}
+
+/* Files committed recently are ranked a bit higher. They're found by running 'git log' over the last few commits
+ * in the background, which is remembered along with the commit it started from. As long as that is still HEAD,
+ * the log only needs to be read up to its first record before it's stopped, and the remembered result used again.
+ * The log is read with -z, so paths come as they are, like the file table's, rather than quoted.
+*/
+struct RecencyBuild
+{
+	SubprocessStream	*log;
+	GHashTable		*recency;		/* Path to recency, the first (most recent) commit to touch a file wins. */
+	guint			commits;		/* Commits read so far. */
+	gboolean		header;			/* The last record was a commit's, so the next path has a newline in front. */
+	gchar			head[64];
+};
+
+static void repository_recency_cancel(Repository *repo)
+{
+	RecencyBuild	*build = repo->recency_build;
+
+	if (build == NULL)
+		return;
+	if (build->log != NULL)
+		subprocess_stream_cancel(build->log);
+	g_hash_table_destroy(build->recency);
+	g_free(build);
+	repo->recency_build = NULL;
+}
+
+/* Copies the repository's recency into its Quick Open list. If the dialog is showing the list, its rows are picked again. */
+static void repository_recency_apply(Repository *repo)
+{
+	QuickOpenIndex	*idx = repo->quick_open;
+	GHashTableIter	iter;
+	gpointer	key, value;
+
+	if (idx == NULL || idx->recency == NULL || repo->quick_open_rows == NULL || repo->recency == NULL)
+		return;
+	memset(idx->recency, 0, idx->rows * sizeof *idx->recency);
+	idx->recent = g_renew(guint32, idx->recent, g_hash_table_size(repo->recency));
+	idx->num_recent = 0;
+	g_hash_table_iter_init(&iter, repo->recency);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		const gint32	file = file_table_find(&repo->files, key);
+
+		if (file >= 0 && repo->quick_open_rows[file] != QO_NO_ROW)
+		{
+			idx->recency[repo->quick_open_rows[file]] = GPOINTER_TO_UINT(value);
+			idx->recent[idx->num_recent++] = repo->quick_open_rows[file];
+		}
+	}
+	if (gitbrowser.quick_open.index == idx && gitbrowser.quick_open.filter_idle == 0)
+		open_quick_reshow(&gitbrowser.quick_open);
+}
+
+static void cb_repository_recency_records(gchar *data, gsize len, gpointer user)
+{
+	Repository	*repo = user;
+	RecencyBuild	*build = repo->recency_build;
+	const gchar	*line;
+
+	for (line = data; line < data + len; line += strlen(line) + 1)
+	{
+		if (line[0] == '\001')
+		{
+			build->header = TRUE;
+			/* The first commit is HEAD. If it's the one we already have the recency for, we're done. */
+			if (build->commits++ == 0)
+			{
+				if (repo->recency != NULL && strcmp(line + 1, repo->recency_head) == 0)
+				{
+					repository_recency_cancel(repo);
+					repository_recency_apply(repo);
+					return;
+				}
+				g_strlcpy(build->head, line + 1, sizeof build->head);
+			}
+		}
+		else
+		{
+			const gchar	*path = line + (build->header && line[0] == '\n' ? 1 : 0);
+
+			build->header = FALSE;
+			if (path[0] != '\0' && !g_hash_table_contains(build->recency, path))
+			{
+				/* From 255 for HEAD down to 1 for the oldest commit looked at. */
+				const guint	recency = 255 - (build->commits - 1) * 254 / (RECENCY_COMMITS - 1);
+
+				g_hash_table_insert(build->recency, g_strdup(path), GUINT_TO_POINTER(recency));
+			}
+		}
+	}
+}
+
+static void cb_repository_recency_done(gboolean success, gpointer user)
+{
+	Repository	*repo = user;
+	RecencyBuild	*build = repo->recency_build;
+
+	build->log = NULL;
+	if (success && build->commits > 0)
+	{
+		if (repo->recency != NULL)
+			g_hash_table_destroy(repo->recency);
+		repo->recency = build->recency;
+		build->recency = g_hash_table_new(g_str_hash, g_str_equal);	/* So cancel has something to destroy. */
+		g_strlcpy(repo->recency_head, build->head, sizeof repo->recency_head);
+		msgwin_status_add(_("Found %u files committed recently in \"%s\"."), g_hash_table_size(repo->recency), repository_get_name(repo));
+	}
+	repository_recency_cancel(repo);
+	repository_recency_apply(repo);
+}
+
+/* Starts finding the recently committed files in the background, unless that's already going on. */
+static void repository_recency_start(Repository *repo)
+{
+	gchar			commits[16];
+	const gchar * const	argv[] = { "git", "log", "-z", "-n", commits, "--name-only", "--no-renames", "--format=%x01%H", NULL };
+	RecencyBuild		*build;
+
+	if (repo->recency_build != NULL)
+		return;
+	g_snprintf(commits, sizeof commits, "%d", RECENCY_COMMITS);
+	build = g_malloc(sizeof *build);
+	build->recency = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	build->commits = 0;
+	build->header = FALSE;
+	build->head[0] = '\0';
+	repo->recency_build = build;
+	if ((build->log = subprocess_stream_start(repo->root_path, argv, '\0', cb_repository_recency_records, cb_repository_recency_done, repo)) == NULL)
+		repository_recency_cancel(repo);
+}
+
+/* Returns the repository's Quick Open list, building it if necessary. That can push other repositories' lists out.
+ * If enabled, untracked files are then listed in the background, since git's ignore rules can be slow to evaluate.
+*/
+static QuickOpenIndex * repository_get_quick_open(Repository *repo)
+{
+	if (repo->quick_open == NULL)
+	{
+		repo->quick_open = open_quick_index_new(FALSE);
+		repository_to_list(repo, repo->quick_open);
+		if (gitbrowser.quick_open_untracked)
+		{
+			const gchar * const	argv[] = { "git", "ls-files", "-z", "--others", "--exclude-standard", NULL };
+
+			repo->untracked = subprocess_stream_start(repo->root_path, argv, '\0', cb_repository_untracked_records, cb_repository_untracked_done, repo);
+		}
+		repository_recency_start(repo);
+	}
+	repo->quick_open_used = g_get_monotonic_time();
+	open_quick_enforce_budget(repo);
+
+	return repo->quick_open;
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+/* Symbols are found by worker threads, a batch of files per job. Only files whose stat data (modification time
+ * and size) in the index differ from what's in the on-disk cache are actually read; files the index doesn't have,
+ * like untracked ones, are stat:ed. The main thread just moves finished jobs into the index, which it alone touches.
+*/
+typedef struct {
+	gint64		mtime;
+	gint64		size;
+	gchar		*symbols;		/* "<line>\t<name>\n" records, as from symbols_extract(). */
+} SymbolFile;
+
+struct SymbolBuild
+{
+	Repository	*repo;			/* NULL once cancelled. */
+	gint		refs;			/* One for the main thread, plus one per job handed to the pool. */
+	gboolean	cancelled;		/* Protected by the lock of 'done'. */
+	GAsyncQueue	*done;			/* Finished SymbolJobs, waiting for the main thread. */
+	GPtrArray	*jobs;			/* Waiting for the cache to load. */
+	GHashTable	*cache;			/* Filename -> SymbolFile, as loaded. Read-only while jobs run. */
+	GHashTable	*indexed;		/* Repository-relative path -> SymbolFile (without symbols), from the index. */
+	GHashTable	*fresh;			/* Filename -> SymbolFile, as found now. Saved when done. */
+	gchar		*cache_filename;
+	gchar		*index_filename;	/* NULL if the repository's git directory isn't known yet. */
+	gchar		*root_prefix;		/* The repository's root path, with a separator. */
+	guint		num_files, num_done, num_parsed;
+	guint		drain;
+	GTimer		*timer;
+};
+
+typedef struct {
+	gchar		*filename;		/* In the filesystem's encoding. Also the key into the cache. */
+	guint32		dir, name;		/* Display names of directory and file, for the index, in the job's 'names'. */
+	SymbolsLanguage	lang;
+	SymbolFile	*cached;		/* The file as last seen, or NULL. */
+	const SymbolFile *indexed;		/* The file as in the index, or NULL. */
+	SymbolFile	found;
+	gboolean	unchanged;		/* If TRUE, use 'cached' rather than 'found'. */
+} SymbolJobFile;
+
+typedef struct {
+	SymbolBuild	*build;
+	GString		*names;
+	SymbolJobFile	files[SYMBOLS_JOB_FILES];
+	guint		num_files;
+} SymbolJob;
+
+static void symbol_file_free(gpointer data)
+{
+	SymbolFile	*sf = data;
+
+	g_free(sf->symbols);
+	g_free(sf);
+}
+
+static void symbol_job_free(SymbolJob *job)
+{
+	for (guint i = 0; i < job->num_files; i++)
+	{
+		g_free(job->files[i].filename);
+		g_free(job->files[i].found.symbols);
+	}
+	g_string_free(job->names, TRUE);
+	g_free(job);
+}
+
+static void symbol_build_unref(SymbolBuild *build)
+{
+	if (!g_atomic_int_dec_and_test(&build->refs))
+		return;
+	g_async_queue_unref(build->done);
+	if (build->jobs != NULL)
+		g_ptr_array_free(build->jobs, TRUE);
+	if (build->cache != NULL)
+		g_hash_table_destroy(build->cache);
+	if (build->indexed != NULL)
+		g_hash_table_destroy(build->indexed);
+	g_hash_table_destroy(build->fresh);
+	g_free(build->cache_filename);
+	g_free(build->index_filename);
+	g_free(build->root_prefix);
+	g_timer_destroy(build->timer);
+	g_free(build);
+}
+
+/* Returns the name of the file that caches a repository's symbols. */
+static gchar * symbol_cache_filename(const Repository *repo)
+{
+	gchar	*dir = g_path_get_dirname(gitbrowser.config_filename), *hash, *base, *fn;
+
+	hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, repo->root_path, -1);
+	base = g_strconcat(hash, ".symbols", NULL);
+	fn = g_build_filename(dir, "symbols", base, NULL);
+	g_free(base);
+	g_free(hash);
+	g_free(dir);
+
+	return fn;
+}
+
+/* Deletes the file that caches a repository's symbols, once the repository itself is removed. */
+static void symbol_cache_remove(const Repository *repo)
+{
+	gchar	*fn = symbol_cache_filename(repo);
+
+	g_unlink(fn);
+	g_free(fn);
+}
+
+/* Loads a symbol cache. The format is text: a header line, then for each file an "F\t<mtime>\t<size>\t<filename>"
+ * line followed by that file's symbol records. The filename is escaped as by g_strescape(), since it can hold anything.
+*/
+static GHashTable * symbol_cache_load(const gchar *filename)
+{
+	GHashTable	*cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, symbol_file_free);
+	gchar		*text, *line, *next;
+	gsize		len;
+	SymbolFile	*sf = NULL;
+	GString		*symbols = NULL;
+
+	if (!g_file_get_contents(filename, &text, &len, NULL))
+		return cache;
+	if (g_str_has_prefix(text, SYMBOLS_CACHE_HEADER))
+	{
+		for (line = text + strlen(SYMBOLS_CACHE_HEADER); *line != '\0'; line = next)
+		{
+			if ((next = strchr(line, '\n')) == NULL)
+				break;
+			*next++ = '\0';
+			if (line[0] == 'F' && line[1] == '\t')
+			{
+				gchar	*fn;
+
+				if (sf != NULL)
+					sf->symbols = g_string_free(symbols, FALSE);
+				sf = g_malloc(sizeof *sf);
+				sf->mtime = g_ascii_strtoll(line + 2, &fn, 10);
+				sf->size = g_ascii_strtoll(fn + 1, &fn, 10);
+				g_hash_table_replace(cache, g_strcompress(fn + 1), sf);
+				symbols = g_string_new(NULL);
+			}
+			else if (sf != NULL)
+			{
+				g_string_append(symbols, line);
+				g_string_append_c(symbols, '\n');
+			}
+		}
+		if (sf != NULL)
+			sf->symbols = g_string_free(symbols, FALSE);
+	}
+	g_free(text);
+
+	return cache;
+}
+
+static void symbol_cache_save(const gchar *filename, GHashTable *files)
+{
+	GString		*out = g_string_new(SYMBOLS_CACHE_HEADER);
+	GHashTableIter	iter;
+	gpointer	key, value;
+	gchar		*dir = g_path_get_dirname(filename);
+
+	g_hash_table_iter_init(&iter, files);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+	{
+		const SymbolFile	*sf = value;
+		gchar			*escaped = g_strescape(key, NULL);
+
+		g_string_append_printf(out, "F\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%s\n", sf->mtime, sf->size, escaped);
+		g_free(escaped);
+		if (sf->symbols != NULL)
+			g_string_append(out, sf->symbols);
+	}
+	g_mkdir_with_parents(dir, 0700);
+	g_file_set_contents(filename, out->str, out->len, NULL);
+	g_free(dir);
+	g_string_free(out, TRUE);
+}
+
+/* Runs in the pool. Takes each file's stat data from the index, or stats it if it isn't there, and only reads it if it
+ * changed since it was cached.
+*/
+static void symbol_job_run(gpointer data, gpointer user)
+{
+	SymbolJob	*job = data;
+	SymbolBuild	*build = job->build;
+
+	for (guint i = 0; i < job->num_files && !g_atomic_int_get(&build->cancelled); i++)
+	{
+		SymbolJobFile	*f = &job->files[i];
+		GStatBuf	st;
+
+		if (f->indexed != NULL)
+		{
+			f->found.mtime = f->indexed->mtime;
+			f->found.size = f->indexed->size;
+		}
+		else if (g_stat(f->filename, &st) == 0)
+		{
+			f->found.mtime = st.st_mtime;
+			f->found.size = st.st_size;
+		}
+		else
+			continue;
+		if (f->cached != NULL && f->cached->mtime == f->found.mtime && f->cached->size == f->found.size)
+			f->unchanged = TRUE;
+		else if (f->found.size <= SYMBOLS_FILE_MAX)
+		{
+			gchar	*text;
+			gsize	len;
+
+			if (g_file_get_contents(f->filename, &text, &len, NULL))
+			{
+				GString	*out = g_string_new(NULL);
+
+				symbols_extract(f->lang, text, len, out);
+				f->found.symbols = g_string_free(out, FALSE);
+				g_free(text);
+			}
+		}
+	}
+	/* Hand the job over, unless the build was cancelled. The queue's lock makes that check race-free. */
+	g_async_queue_lock(build->done);
+	if (!build->cancelled)
+	{
+		g_async_queue_push_unlocked(build->done, job);
+		job = NULL;
+	}
+	g_async_queue_unlock(build->done);
+	if (job != NULL)
+	{
+		symbol_job_free(job);
+		symbol_build_unref(build);
+	}
+}
+
+/* Appends a file's symbol records to the index. */
+static void symbol_index_append(QuickOpenIndex *idx, const gchar *symbols, const gchar *dir, const gchar *file)
+{
+	const guint32	dir_id = strtab_intern(&idx->names, dir, -1), file_id = strtab_intern(&idx->names, file, -1);
+	RoaringBitmap	*ext = open_quick_index_extension(idx, file);	/* A symbol has the extension of its file. */
+	const gchar	*rec, *eol;
+
+	for (rec = symbols; (eol = strchr(rec, '\n')) != NULL; rec = eol + 1)
+	{
+		gchar		*name;
+		const guint32	line = (guint32) strtoul(rec, &name, 10);
+
+		if (*name++ == '\t' && name < eol)
+		{
+			const guint32	row = open_quick_index_append(idx, name, eol - name, dir_id);
+
+			idx->file[row] = file_id;
+			idx->line[row] = line;
+			if (ext != NULL)
+				roaring_add(ext, row);
+		}
+	}
+}
+
+static void symbol_cache_save_thread(GTask *task, gpointer source, gpointer data, GCancellable *cancel)
+{
+	SymbolBuild	*build = data;
+
+	symbol_cache_save(build->cache_filename, build->fresh);
+	symbol_build_unref(build);
+	g_task_return_boolean(task, TRUE);
+}
+
+/* The index is complete, so the cache is saved. That's done in a thread, with a reference of its own to the build. */
+static void symbol_build_finish(SymbolBuild *build)
+{
+	Repository	*repo = build->repo;
+	GTask		*task;
+
+	msgwin_status_add(_("Found %lu symbols in %u files of \"%s\" in %.1f ms (%u files read, the rest cached), using %lu KB."),
+			(unsigned long) repo->symbols->rows, build->num_files, repository_get_name(repo), 1e3 * g_timer_elapsed(build->timer, NULL),
+			build->num_parsed, (unsigned long) (open_quick_index_memory(repo->symbols) >> 10));
+	repo->symbols_build = NULL;
+	build->repo = NULL;
+	build->drain = 0;
+	task = g_task_new(NULL, NULL, NULL, NULL);
+	g_task_set_task_data(task, build, NULL);
+	g_task_run_in_thread(task, symbol_cache_save_thread);
+	g_object_unref(task);
+	if (gitbrowser.quick_open.index == repo->symbols)
+		open_quick_update_label(&gitbrowser.quick_open);
+	open_quick_enforce_budget(repo);
+}
+
+/* Moves finished jobs into the index, for a limited time per call so the interface stays responsive. */
+static gboolean cb_symbol_build_drain(gpointer user)
+{
+	SymbolBuild	*build = user;
+	QuickOpenIndex	*idx = build->repo->symbols;
+	const guint32	first = idx->rows;
+	const gdouble	max_time = 1e-3 * gitbrowser.quick_open_filter_max_time;
+	GTimer		*tmr = g_timer_new();
+	SymbolJob	*job;
+
+	while (g_timer_elapsed(tmr, NULL) < max_time && (job = g_async_queue_try_pop(build->done)) != NULL)
+	{
+		for (guint i = 0; i < job->num_files; i++)
+		{
+			SymbolJobFile	*f = &job->files[i];
+			SymbolFile	*sf = g_malloc(sizeof *sf);
+
+			/* Move the symbols over into the fresh cache, they're copied into the index anyway. */
+			if (f->unchanged)
+			{
+				*sf = *f->cached;
+				f->cached->symbols = NULL;
+			}
+			else
+			{
+				*sf = f->found;
+				f->found.symbols = NULL;
+				build->num_parsed++;
+			}
+			if (sf->symbols != NULL)
+				symbol_index_append(idx, sf->symbols, job->names->str + f->dir, job->names->str + f->name);
+			g_hash_table_replace(build->fresh, f->filename, sf);
+			f->filename = NULL;
+		}
+		build->num_done += job->num_files;
+		symbol_job_free(job);
+		symbol_build_unref(build);
+	}
+	g_timer_destroy(tmr);
+	if (gitbrowser.quick_open.index == idx && idx->rows > first)
+		open_quick_rows_added(&gitbrowser.quick_open, first);
+	if (build->num_done == build->num_files)
+	{
+		symbol_build_finish(build);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* Keeps the stat data of the (source) files in the index, keyed by their path with the local separator. */
+static void cb_symbol_index_entry(const GitIndexEntry *entry, gpointer user)
+{
+	GHashTable	*indexed = user;
+	const gchar	*slash = strrchr(entry->path, '/');
+	SymbolFile	*sf;
+	gchar		*path;
+
+	if (entry->stage != 0 || symbols_language_from_filename(slash != NULL ? slash + 1 : entry->path) == SYMBOLS_LANGUAGE_NONE)
+		return;
+	sf = g_malloc(sizeof *sf);
+	sf->mtime = entry->mtime_sec;
+	sf->size = entry->size;
+	sf->symbols = NULL;
+	path = g_strndup(entry->path, entry->path_len);
+	g_strdelimit(path, "/", G_DIR_SEPARATOR);
+	g_hash_table_replace(indexed, path, sf);
+}
+
+/* Loads the cache, and the stat data in the index. Without a readable index, every file is stat:ed instead. */
+static void symbol_cache_load_thread(GTask *task, gpointer source, gpointer data, GCancellable *cancel)
+{
+	SymbolBuild	*build = data;
+
+	build->cache = symbol_cache_load(build->cache_filename);
+	if (build->index_filename != NULL)
+	{
+		build->indexed = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, symbol_file_free);
+		if (!gitindex_read(build->index_filename, cb_symbol_index_entry, build->indexed))
+		{
+			g_hash_table_destroy(build->indexed);
+			build->indexed = NULL;
+		}
+	}
+	g_task_return_boolean(task, TRUE);
+}
+
+/* The cache is in, so the jobs can go to the pool. */
+static void cb_symbol_cache_loaded(GObject *source, GAsyncResult *res, gpointer user)
+{
+	SymbolBuild	*build = user;
+
+	if (build->repo != NULL)
+	{
+		if (gitbrowser.symbol_pool == NULL)
+			gitbrowser.symbol_pool = g_thread_pool_new(symbol_job_run, NULL, g_get_num_processors(), FALSE, NULL);
+		for (guint i = 0; i < build->jobs->len; i++)
+		{
+			SymbolJob	*job = g_ptr_array_index(build->jobs, i);
+
+			for (guint j = 0; j < job->num_files; j++)
+			{
+				SymbolJobFile	*f = &job->files[j];
+
+				f->cached = g_hash_table_lookup(build->cache, f->filename);
+				if (build->indexed != NULL && g_str_has_prefix(f->filename, build->root_prefix))
+					f->indexed = g_hash_table_lookup(build->indexed, f->filename + strlen(build->root_prefix));
+			}
+			g_atomic_int_inc(&build->refs);
+			g_thread_pool_push(gitbrowser.symbol_pool, job, NULL);
+		}
+		/* The jobs belong to the pool now. */
+		g_ptr_array_set_free_func(build->jobs, NULL);
+		g_ptr_array_free(build->jobs, TRUE);
+		build->jobs = NULL;
+		if (build->num_files == 0)
+			symbol_build_finish(build);
+		else
+			build->drain = g_timeout_add(50, cb_symbol_build_drain, build);
+	}
+	symbol_build_unref(build);
+}
+
+/* Starts finding the symbols in all the (source) files of a repository's Quick Open list. The files are handed to the
+ * pool in batches, so there's one job per SYMBOLS_JOB_FILES files rather than per file.
+*/
+static SymbolBuild * symbol_build_start(Repository *repo, const QuickOpenIndex *files)
+{
+	SymbolBuild	*build = g_malloc0(sizeof *build);
+	SymbolJob	*job = NULL;
+	GTask		*task;
+
+	build->repo = repo;
+	build->refs = 2;			/* The main thread, and the cache loading task. */
+	build->done = g_async_queue_new();
+	build->jobs = g_ptr_array_new_with_free_func((GDestroyNotify) symbol_job_free);
+	build->fresh = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, symbol_file_free);
+	build->cache_filename = symbol_cache_filename(repo);
+	if (repo->git_dir != NULL)
+		build->index_filename = g_build_filename(repo->git_dir, "index", NULL);
+	build->root_prefix = g_strconcat(repo->root_path, G_DIR_SEPARATOR_S, NULL);
+	build->timer = g_timer_new();
+	for (guint32 i = 0; i < files->rows; i++)
+	{
+		const gchar		*name = strtab_get(&files->names, files->name[i]), *dir = strtab_get(&files->names, files->path[i]);
+		const SymbolsLanguage	lang = symbols_language_from_filename(name);
+		gchar			*full, *fn;
+
+		if (lang == SYMBOLS_LANGUAGE_NONE)
+			continue;
+		full = g_strconcat(dir, G_DIR_SEPARATOR_S, name, NULL);
+		if ((fn = g_filename_from_utf8(full, -1, NULL, NULL, NULL)) != NULL)
+		{
+			SymbolJobFile	*f;
+
+			if (job == NULL || job->num_files == SYMBOLS_JOB_FILES)
+			{
+				job = g_malloc0(sizeof *job);
+				job->build = build;
+				job->names = g_string_new(NULL);
+				g_ptr_array_add(build->jobs, job);
+			}
+			f = &job->files[job->num_files++];
+			f->filename = fn;
+			f->lang = lang;
+			/* The file's directory is usually that of the one before it. */
+			if (job->num_files > 1 && strcmp(job->names->str + job->files[job->num_files - 2].dir, dir) == 0)
+				f->dir = job->files[job->num_files - 2].dir;
+			else
+			{
+				f->dir = job->names->len;
+				g_string_append_len(job->names, dir, strlen(dir) + 1);
+			}
+			f->name = job->names->len;
+			g_string_append_len(job->names, name, strlen(name) + 1);
+			build->num_files++;
+		}
+		g_free(full);
+	}
+
+	task = g_task_new(NULL, NULL, cb_symbol_cache_loaded, build);
+	g_task_set_task_data(task, build, NULL);
+	g_task_run_in_thread(task, symbol_cache_load_thread);
+	g_object_unref(task);
+
+	return build;
+}
+
+/* Stops a build. Jobs still in the pool notice, and skip their work. */
+static void symbol_build_cancel(SymbolBuild *build)
+{
+	SymbolJob	*job;
+
+	g_async_queue_lock(build->done);
+	build->cancelled = TRUE;
+	while ((job = g_async_queue_try_pop_unlocked(build->done)) != NULL)
+	{
+		symbol_job_free(job);
+		g_atomic_int_add(&build->refs, -1);	/* Can't be the last reference, the main thread still has one. */
+	}
+	g_async_queue_unlock(build->done);
+	build->repo = NULL;
+	if (build->drain != 0)
+		g_source_remove(build->drain);
+	symbol_build_unref(build);
+}
+
+/* Returns the repository's symbol list. If it's not there, building starts in the background and the list
+ * fills up as symbols are found. Like the file list, this can push other repositories' lists out.
+*/
+static QuickOpenIndex * repository_get_symbols(Repository *repo)
+{
+	if (repo->symbols == NULL)
+	{
+		const QuickOpenIndex	*files = repository_get_quick_open(repo);
+
+		repo->symbols = open_quick_index_new(TRUE);
+		repo->symbols_build = symbol_build_start(repo, files);
+	}
+	repo->quick_open_used = g_get_monotonic_time();
+	open_quick_enforce_budget(repo);
+
+	return repo->symbols;
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+void repository_save_all(GtkTreeModel *model)
+{
+	GtkTreeIter	root, iter;
+	GString		*repos = NULL;
+	GKeyFile	*out;
+	gchar		*data;
+
+	if (gtk_tree_model_get_iter_first(model, &root) && gtk_tree_model_iter_children(model, &iter, &root))
+	{
+		repos = g_string_new("");
+		do
+		{
+			const gchar	*dpath;
+			gchar		*fn;
+
+			gtk_tree_model_get(model, &iter, 1, &dpath, -1);
+			if (dpath == NULL)
+			{
+				if (repos->len > 0)
+					g_string_append_c(repos, PATH_SEPARATOR_CHAR);
+				g_string_append(repos, REPO_IS_SEPARATOR);
+			}
+			else
+			{
+				if ((fn = g_filename_from_utf8(dpath, -1, NULL, NULL, NULL)) != NULL)
+				{
+					if (repos->len > 0)
+						g_string_append_c(repos, PATH_SEPARATOR_CHAR);
+					g_string_append(repos, fn);
+					g_free(fn);
+				}
+			}
+		} while (gtk_tree_model_iter_next(model, &iter));
+	}
+
+	out = g_key_file_new();
+
+	if (repos != NULL)
+	{
+		GString	*exp = gitbrowser.expanded != NULL ? g_string_new(gitbrowser.expanded) : tree_view_get_expanded(GTK_TREE_VIEW(gitbrowser.view));
+
+		g_key_file_set_string(out, MNEMONIC_NAME, CFG_REPOSITORIES, repos->str);
+		g_string_free(repos, TRUE);
+		if (exp != NULL)
+		{
+			if (exp->len > 0)
+				g_key_file_set_string(out, MNEMONIC_NAME, CFG_EXPANDED, exp->str);
+			g_string_free(exp, TRUE);
+		}
+	}
+	stash_group_save_to_key_file(gitbrowser.prefs, out);
+
+	if ((data = g_key_file_to_data(out, NULL, NULL)) != NULL)
+	{
+		utils_write_file(gitbrowser.config_filename, data);
+		g_free(data);
+	}
+	g_key_file_free(out);
+}
+
+void repository_load_all(void)
+{
+	GKeyFile	*in;
+
+	in = g_key_file_new();
+	if (g_key_file_load_from_file(in, gitbrowser.config_filename, G_KEY_FILE_NONE, NULL))
+	{
+		gchar	*str;
+
+		if ((str = g_key_file_get_string(in, MNEMONIC_NAME, CFG_REPOSITORIES, NULL)) != NULL)
+		{
+			gchar	separator[] = { PATH_SEPARATOR_CHAR, '\0' };
+			gchar	**repo_vector = g_strsplit(str, separator, 0);
+			gchar	*exp;
+
+			/* The rows go in as configured, the listing is started in priority order once they're all queued. At
+			 * startup, that's not until Geany has opened the session's documents, to know which one is current.
+			*/
+			repository_list_hold(TRUE);
+			for (gsize i = 0; repo_vector[i] != NULL; i++)
+			{
+				if (strcmp(repo_vector[i], REPO_IS_SEPARATOR) == 0)
+					tree_model_build_separator(gitbrowser.model);
+				else
+				{
+					Repository	*repo = repository_new(repo_vector[i]);
+					tree_model_build_repository(gitbrowser.model, NULL, repo);
+				}
+			}
+			if (main_is_realized())
+				repository_list_hold(FALSE);
+			else
+				plugin_signal_connect(gitbrowser.plugin, NULL, "geany-startup-complete", FALSE, G_CALLBACK(cb_repository_list_startup), NULL);
+			g_free(str);
+			exp = g_key_file_get_string(in, MNEMONIC_NAME, CFG_EXPANDED, NULL);
+			/* Note: Both of these calls do the right thing even if exp == NULL. */
+			tree_view_set_expanded(GTK_TREE_VIEW(gitbrowser.view), exp);
+			/* The repositories' own rows are expanded as they're listed, if there are any. */
+			g_free(gitbrowser.expanded);
+			gitbrowser.expanded = exp != NULL ? exp : g_strdup("");
+			repository_list_settle();
+		}
+	}
+	stash_group_load_from_key_file(gitbrowser.prefs, in);
+	open_quick_reset_filter();
+
+	g_key_file_free(in);
+}
+
+/* Builds the full (UTF-8) filename of a row in the Quick Open list. For a symbol, that's the file it's in. Returns FALSE if it doesn't fit. */
+static gboolean open_quick_row_filename(const QuickOpenInfo *qoi, guint row, gchar *buf, gsize buf_max)
+{
+	const QuickOpenIndex	*idx = qoi->index;
+	const guint32		file = idx->file != NULL ? idx->file[row] : idx->name[row];
+
+	return g_snprintf(buf, buf_max, "%s%s%s", strtab_get(&idx->names, idx->path[row]), G_DIR_SEPARATOR_S, strtab_get(&idx->names, file)) < buf_max;
+}
+
+/* Decides if the start of a file is text worth showing, and cuts it down to a screenful. Returns NULL for binary files. */
+static gchar * open_quick_preview_text(const gchar *buf, gsize len, gboolean truncated)
+{
+	const gchar	*end, *put;
+	guint		lines = 0;
+
+	if (memchr(buf, '\0', len) != NULL)
+		return NULL;
+	if (!g_utf8_validate(buf, len, &end))
+	{
+		/* A character cut in half by the read limit is fine, anything else isn't text. */
+		if (!truncated || len - (end - buf) > 3)
+			return NULL;
+		len = end - buf;
+	}
+	for (put = buf; put < buf + len && lines < PREVIEW_LINES_MAX; put++)
+	{
+		if (*put == '\n')
+			lines++;
+	}
+	return g_strndup(buf, put - buf);
+}
+
+/* Runs in a worker thread. Reads at most PREVIEW_READ_MAX bytes, so a slow disk can only delay the preview itself. */
+static void open_quick_preview_thread(GTask *task, gpointer source, gpointer data, GCancellable *cancel)
+{
+	GFile		*file = g_file_new_for_path(data);
+	GFileInfo	*info;
+	gchar		*text = NULL;
+
+	if ((info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE, G_FILE_QUERY_INFO_NONE, cancel, NULL)) != NULL)
+	{
+		if (g_file_info_get_file_type(info) != G_FILE_TYPE_REGULAR)
+			text = g_strdup(_("(Not a regular file.)"));
+		else if (g_file_info_get_size(info) > PREVIEW_FILE_MAX)
+			text = g_strdup_printf(_("(Too large to preview, %lu KB.)"), (unsigned long) (g_file_info_get_size(info) >> 10));
+		else
+		{
+			GFileInputStream	*in;
+
+			if ((in = g_file_read(file, cancel, NULL)) != NULL)
+			{
+				gchar	buf[PREVIEW_READ_MAX];
+				gsize	got = 0;
+
+				if (g_input_stream_read_all(G_INPUT_STREAM(in), buf, sizeof buf, &got, cancel, NULL))
+				{
+					if ((text = open_quick_preview_text(buf, got, got == sizeof buf)) == NULL)
+						text = g_strdup(_("(Binary file.)"));
+				}
+				g_object_unref(in);
+			}
+		}
+		g_object_unref(info);
+	}
+	g_object_unref(file);
+	if (text == NULL)
+		text = g_strdup(_("(Could not read file.)"));
+	g_task_return_pointer(task, text, g_free);
+}
+
+static void cb_open_quick_preview_ready(GObject *source, GAsyncResult *res, gpointer user)
+{
+	QuickOpenInfo	*qoi = user;
+	gchar		*text;
+
+	/* A cancelled task returns an error, so stale previews never make it here. */
+	if ((text = g_task_propagate_pointer(G_TASK(res), NULL)) != NULL)
+	{
+		gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(qoi->preview)), text, -1);
+		g_free(text);
+	}
+}
+
+static void open_quick_preview_stop(QuickOpenInfo *qoi)
+{
+	if (qoi->preview_cancel != NULL)
+	{
+		g_cancellable_cancel(qoi->preview_cancel);
+		g_object_unref(qoi->preview_cancel);
+		qoi->preview_cancel = NULL;
+	}
+}
+
+/* Starts reading a preview of the selected file, if there is exactly one. Any preview still being read is abandoned. */
+static void open_quick_preview_start(QuickOpenInfo *qoi)
+{
+	GList		*selection;
+	GtkTreeIter	iter;
+	gboolean	started = FALSE;
+
+	open_quick_preview_stop(qoi);
+	if (!gitbrowser.quick_open_preview || qoi->index == NULL)
+		return;
+	selection = gtk_tree_selection_get_selected_rows(qoi->selection, NULL);
+	if (selection != NULL && selection->next == NULL && gtk_tree_model_get_iter(GTK_TREE_MODEL(qoi->store), &iter, selection->data))
+	{
+		gchar	buf[2048], *fn;
+		guint	row;
+
+		gtk_tree_model_get(GTK_TREE_MODEL(qoi->store), &iter, QO_ROW, &row, -1);
+		if (row != QO_ROW_MORE && open_quick_row_filename(qoi, row, buf, sizeof buf) && (fn = g_filename_from_utf8(buf, -1, NULL, NULL, NULL)) != NULL)
+		{
+			GTask	*task;
+
+			qoi->preview_cancel = g_cancellable_new();
+			task = g_task_new(NULL, qoi->preview_cancel, cb_open_quick_preview_ready, qoi);
+			g_task_set_task_data(task, fn, g_free);
+			g_task_run_in_thread(task, open_quick_preview_thread);
+			g_object_unref(task);
+			started = TRUE;
+		}
+	}
+	g_list_foreach(selection, (GFunc) gtk_tree_path_free, NULL);
+	g_list_free(selection);
+	/* Keep showing the old preview until the new one arrives, to avoid flicker. Only clear it if there's nothing to show. */
+	if (!started)
+		gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(qoi->preview)), "", -1);
+}
+
+static void evt_open_quick_selection_changed(GtkTreeSelection *sel, gpointer user)
+{
+	QuickOpenInfo	*qoi = user;
+
+	gtk_dialog_set_response_sensitive(GTK_DIALOG(qoi->dialog), GTK_RESPONSE_OK, gtk_tree_selection_count_selected_rows(sel) > 0);
+	open_quick_preview_start(qoi);
+}
+
+static void evt_open_quick_view_row_activated(GtkWidget *view, GtkTreePath *path, GtkTreeViewColumn *column, gpointer user)
+{
+	QuickOpenInfo	*qoi = user;
+
+	gtk_dialog_response(GTK_DIALOG(qoi->dialog), GTK_RESPONSE_OK);
+}
+
+/* Returns how many rows the dialog picks its matches from; the whole index, or just the rows in the scope. */
+static gulong open_quick_total(const QuickOpenInfo *qoi)
+{
+	if (qoi->index == NULL)
+		return 0;
+	return qoi->scope != NULL ? qoi->scope_num : open_quick_index_size(qoi->index);
+}
+
+static void open_quick_update_label(QuickOpenInfo *qoi)
+{
+	gchar	buf[128];
+
+	const gulong	files_total = open_quick_total(qoi);
+
+	if (qoi->filter_invalid)
+		g_snprintf(buf, sizeof buf, _("Not a valid regular expression."));
+	else if (qoi->index != NULL && qoi->index->line != NULL)
+	{
+		const gboolean	building = qoi->repo != NULL && qoi->repo->symbols_build != NULL;
+
+		if (qoi->files_filtered == 0)
+			g_snprintf(buf, sizeof buf, building ? _("Showing all %lu symbols, still looking for more.") : _("Showing all %lu symbols."), files_total);
+		else
+			g_snprintf(buf, sizeof buf, building ? _("Showing %lu/%lu symbols, still looking for more.") : _("Showing %lu/%lu symbols."), files_total - qoi->files_filtered, files_total);
+	}
+	else if (qoi->files_filtered == 0)
+		g_snprintf(buf, sizeof buf, _("Showing all %lu files."), files_total);
+	else
+		g_snprintf(buf, sizeof buf, _("Showing %lu/%lu files."), files_total - qoi->files_filtered, files_total);
+	gtk_label_set_text(GTK_LABEL(qoi->label), buf);
+}
+
+/* Packs what a row is ranked on first into one number, lower is better: its distance, lowered a bit if the file
+ * was committed recently, and then the recency itself to break ties. This is compared before any names are.
+*/
+static guint32 open_quick_rank_key(const QuickOpenIndex *idx, guint32 row)
+{
+	const guint	recency = idx->recency != NULL ? idx->recency[row] : 0;
+	const guint	boost = (recency * RECENCY_BOOST_MAX + 254) / 255;
+	const guint	distance = idx->distance[row] > boost ? idx->distance[row] - boost : 0;
+
+	return ((guint32) distance << 8) | (255 - recency);
+}
+
+/* Ranks on distance (with recency, see above), then on name. Names are compared as plain (lower-case) bytes, which is a lot cheaper
+ * than collating and gives the same order for the vast majority of file names. Row order breaks any ties.
+*/
+static gint open_quick_rank_compare(const QuickOpenIndex *idx, guint32 a, guint32 b)
+{
+	const guint32	ka = open_quick_rank_key(idx, a), kb = open_quick_rank_key(idx, b);
+	gint		rel;
+
+	if (ka != kb)
+		return ka < kb ? -1 : 1;
+	if ((rel = strcmp(strtab_get(&idx->names, idx->name_lower[a]), strtab_get(&idx->names, idx->name_lower[b]))) != 0)
+		return rel;
+	return a < b ? -1 : a > b;
+}
+
+/* Restores the heap order of a max-heap (worst-ranked row on top) after the row at <i> got worse, or was replaced. */
+static void open_quick_heap_down(const QuickOpenIndex *idx, guint32 *heap, guint32 n, guint32 i)
+{
+	for (;;)
+	{
+		guint32	worst = i, child = 2 * i + 1;
+
+		if (child < n && open_quick_rank_compare(idx, heap[child], heap[worst]) > 0)
+			worst = child;
+		if (child + 1 < n && open_quick_rank_compare(idx, heap[child + 1], heap[worst]) > 0)
+			worst = child + 1;
+		if (worst == i)
+			return;
+		const guint32	tmp = heap[i];
+		heap[i] = heap[worst];
+		heap[worst] = tmp;
+		i = worst;
+	}
+}
+
+static void open_quick_heap_up(const QuickOpenIndex *idx, guint32 *heap, guint32 i)
+{
+	while (i > 0 && open_quick_rank_compare(idx, heap[i], heap[(i - 1) / 2]) > 0)
+	{
+		const guint32	tmp = heap[i];
+		heap[i] = heap[(i - 1) / 2];
+		heap[(i - 1) / 2] = tmp;
+		i = (i - 1) / 2;
+	}
+}
+
+/* Puts the best 'shown_max' matches into the list store, best first, plus a "show more" row if there are more.
+ * They are picked with a bounded heap, so this costs a pass over the visible bitset but never a full sort,
+ * and the view only ever has to lay out and draw a page's worth of rows however big the repository is.
+*/
+static void open_quick_show(QuickOpenInfo *qoi, guint32 cursor)
+{
+	const QuickOpenIndex	*idx = qoi->index;
+	guint32			*heap, n = 0;
+
+	if (qoi->shown_alloc < qoi->shown_max)
+	{
+		qoi->shown_alloc = qoi->shown_max;
+		qoi->shown = g_renew(guint32, qoi->shown, qoi->shown_alloc);
+	}
+	heap = qoi->shown;
+	for (guint32 w = 0; w < BITSET_WORDS(idx->rows); w++)
+	{
+		/* Whole words of hidden rows are skipped in one go, which is most of them when filtering. */
+		for (guint32 bits = idx->visible[w]; bits != 0; bits &= bits - 1)
+		{
+			const guint32	row = 32 * w + g_bit_nth_lsf(bits, -1);
+
+			if (row >= idx->rows)
+				break;
+			if (n < qoi->shown_max)
+			{
+				heap[n] = row;
+				open_quick_heap_up(idx, heap, n++);
+			}
+			else if (open_quick_rank_compare(idx, row, heap[0]) < 0)
+			{
+				heap[0] = row;
+				open_quick_heap_down(idx, heap, n, 0);
+			}
+		}
+	}
+	/* Sort the heap in place, by repeatedly moving the worst remaining row to the end. */
+	for (guint32 k = n; k > 1; k--)
+	{
+		const guint32	tmp = heap[0];
+		heap[0] = heap[k - 1];
+		heap[k - 1] = tmp;
+		open_quick_heap_down(idx, heap, k - 1, 0);
+	}
+	qoi->shown_rows = n;
+
+	/* Keep the view out of it while re-filling the store, then put the cursor back. */
+	gtk_tree_view_set_model(GTK_TREE_VIEW(qoi->view), NULL);
+	gtk_list_store_clear(qoi->store);
+	for (guint32 i = 0; i < n; i++)
+		gtk_list_store_insert_with_values(qoi->store, NULL, -1, QO_ROW, qoi->shown[i], -1);
+	if (qoi->filter_idle == 0 && open_quick_total(qoi) - qoi->files_filtered > n)
+		gtk_list_store_insert_with_values(qoi->store, NULL, -1, QO_ROW, QO_ROW_MORE, -1);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(qoi->view), GTK_TREE_MODEL(qoi->store));
+	if (gtk_tree_model_iter_n_children(GTK_TREE_MODEL(qoi->store), NULL) > 0)
+	{
+		GtkTreePath	*path = gtk_tree_path_new_from_indices(MIN(cursor, n), -1);
+
+		gtk_tree_view_set_cursor(GTK_TREE_VIEW(qoi->view), path, NULL, FALSE);
+		gtk_tree_path_free(path);
+	}
+}
+
+/* Picks the rows to show again, leaving the cursor where it was. */
+static void open_quick_reshow(QuickOpenInfo *qoi)
+{
+	GtkTreePath	*cursor = NULL;
+	guint32		at = 0;
+
+	gtk_tree_view_get_cursor(GTK_TREE_VIEW(qoi->view), &cursor, NULL);
+	if (cursor != NULL)
+	{
+		at = gtk_tree_path_get_indices(cursor)[0];
+		gtk_tree_path_free(cursor);
+	}
+	open_quick_show(qoi, at);
+}
+
+/* Shows another page's worth of matches, with the cursor on the first new one. */
+static void open_quick_show_more(QuickOpenInfo *qoi)
+{
+	const guint32	first = qoi->shown_rows;
+
+	qoi->shown_max += gitbrowser.quick_open_max_rows;
+	open_quick_show(qoi, first);
+}
+
+/* Returns TRUE if the "show more" row, and nothing else, is selected. */
+static gboolean open_quick_more_selected(const QuickOpenInfo *qoi)
+{
+	GList		*selection = gtk_tree_selection_get_selected_rows(qoi->selection, NULL);
+	GtkTreeIter	iter;
+	guint		row = 0;
+
+	if (selection != NULL && selection->next == NULL && gtk_tree_model_get_iter(GTK_TREE_MODEL(qoi->store), &iter, selection->data))
+		gtk_tree_model_get(GTK_TREE_MODEL(qoi->store), &iter, QO_ROW, &row, -1);
+	g_list_foreach(selection, (GFunc) gtk_tree_path_free, NULL);
+	g_list_free(selection);
+	return row == QO_ROW_MORE;
+}
+
+static void open_quick_filter_spill_clear(QuickOpenInfo *qoi)
+{
+	for (guint32 spilled = qoi->filter_spilled; spilled != 0; spilled &= spilled - 1)
+	{
+		g_free(qoi->filter_spill[g_bit_nth_lsf(spilled, -1)]);
+		qoi->filter_spill[g_bit_nth_lsf(spilled, -1)] = NULL;
+	}
+	qoi->filter_spilled = 0;
+}
+
+/* Checks a lower-case name against the filter. For a regex, the required literals are checked first, since
+ * plain sub-string searches are a lot faster than running the regex engine, and reject most names.
+*/
+static gboolean open_quick_filter_match(const QuickOpenInfo *qoi, const gchar *name_lower)
+{
+	if (qoi->filter_regex != NULL)
+	{
+		for (gchar **lit = qoi->filter_literals; *lit != NULL; lit++)
+		{
+			if (strstr(name_lower, *lit) == NULL)
+				return FALSE;
+		}
+		return g_regex_match(qoi->filter_regex, name_lower, 0, NULL);
+	}
+	if (qoi->filter_ac != NULL)
+	{
+		guint32	found = ahocorasick_scan(qoi->filter_ac, name_lower);
+
+		for (guint32 spilled = qoi->filter_spilled; spilled != 0; spilled &= spilled - 1)
+		{
+			const guint	i = g_bit_nth_lsf(spilled, -1);
+
+			if (strstr(name_lower, qoi->filter_spill[i]) != NULL)
+				found |= 1u << i;
+		}
+		return (found & qoi->filter_need) == qoi->filter_need && (found & qoi->filter_reject) == 0;
+	}
+	return !qoi->filter_invalid && strstr(name_lower, qoi->filter_lower) != NULL;
+}
+
+/* Brings the extension mask up to date with the index, by OR:ing together the bitmaps of the wanted extensions.
+ * That costs time in proportion to how many rows have those extensions, not to the size of the index.
+*/
+static void open_quick_filter_mask_update(QuickOpenInfo *qoi)
+{
+	const QuickOpenIndex	*idx = qoi->index;
+
+	if (qoi->filter_extensions == NULL || qoi->filter_mask_rows == idx->rows)
+		return;
+	qoi->filter_mask = g_renew(guint32, qoi->filter_mask, BITSET_WORDS(idx->rows));
+	memset(qoi->filter_mask, 0, BITSET_WORDS(idx->rows) * sizeof *qoi->filter_mask);
+	for (gchar **ext = qoi->filter_extensions; *ext != NULL; ext++)
+	{
+		const RoaringBitmap	*rows = g_hash_table_lookup(idx->extensions, *ext);
+
+		if (rows != NULL)
+			roaring_or_into_bitset(rows, qoi->filter_mask, idx->rows);
+	}
+	qoi->filter_mask_rows = idx->rows;
+}
+
+/* Returns TRUE if a row's directory is the scope directory, or inside it. */
+static gboolean open_quick_row_in_scope(const QuickOpenInfo *qoi, guint32 row)
+{
+	const gchar	*dir = strtab_get(&qoi->index->names, qoi->index->path[row]);
+	const gsize	len = strlen(qoi->scope);
+
+	return strncmp(dir, qoi->scope, len) == 0 && (dir[len] == '\0' || dir[len] == G_DIR_SEPARATOR);
+}
+
+static void open_quick_scope_append(QuickOpenInfo *qoi, guint32 row)
+{
+	if (qoi->scope_num == qoi->scope_alloc)
+	{
+		qoi->scope_alloc = qoi->scope_alloc == 0 ? 1024 : 2 * qoi->scope_alloc;
+		qoi->scope_rows = g_renew(guint32, qoi->scope_rows, qoi->scope_alloc);
+	}
+	qoi->scope_rows[qoi->scope_num++] = row;
+}
+
+/* Collects the rows in the scope directory. The tracked files in there are a contiguous run of the
+ * sorted file table, found by two binary searches, so only untracked files and symbols need their directories checked.
+*/
+static void open_quick_scope_build(QuickOpenInfo *qoi)
+{
+	QuickOpenIndex		*idx = qoi->index;
+	const Repository	*repo = qoi->repo;
+	guint32			first = 0;
+
+	qoi->scope_num = 0;
+	if (idx == repo->quick_open && repo->quick_open_rows != NULL)
+	{
+		gchar		*end = g_strdup(qoi->scope_prefix);
+		guint32		lo, hi;
+
+		end[strlen(end) - 1] = '/' + 1;
+		lo = file_table_lower_bound(&repo->files, qoi->scope_prefix);
+		hi = file_table_lower_bound(&repo->files, end);
+		g_free(end);
+		for (guint32 i = lo; i < hi; i++)
+		{
+			if (repo->quick_open_rows[i] != QO_NO_ROW)
+				open_quick_scope_append(qoi, repo->quick_open_rows[i]);
+		}
+		first = repo->quick_open_tracked;
+	}
+	for (guint32 row = first; row < idx->rows; row++)
+	{
+		if (!BITSET_TEST(idx->dead, row) && open_quick_row_in_scope(qoi, row))
+			open_quick_scope_append(qoi, row);
+	}
+	qoi->scope_valid = TRUE;
+}
+
+/* Decides if a single row passes the filter, and if so, how well. */
+static void open_quick_filter_row(QuickOpenInfo *qoi, LDState *ld, guint32 row)
+{
+	QuickOpenIndex	*idx = qoi->index;
+
+	if (BITSET_TEST(idx->dead, row))
+		BITSET_CLEAR(idx->visible, row);
+	else if ((qoi->filter_extensions == NULL || BITSET_TEST(qoi->filter_mask, row)) && open_quick_filter_match(qoi, strtab_get(&idx->names, idx->name_lower[row])))
+	{
+		BITSET_SET(idx->visible, row);
+		idx->distance[row] = levenshtein_compute_half(ld, strtab_get(&idx->names, idx->name[row]));
+	}
+	else
+	{
+		BITSET_CLEAR(idx->visible, row);
+		qoi->files_filtered++;
+	}
+}
+
+/* Shows rows appended to the index after the dialog was attached to it. If a filtering pass is running it
+ * will get to the new rows by itself, otherwise they're filtered right here. The shown rows are only picked
+ * again if a new match belongs among them, so mostly the list (and the cursor) is left alone. Rows outside
+ * the scope, if any, are just hidden.
+*/
+static void open_quick_rows_added(QuickOpenInfo *qoi, guint32 first)
+{
+	/* A running pass may show its matches before it gets to the new rows, so keep them hidden until then. */
+	for (guint32 i = first; i < qoi->index->rows; i++)
+	{
+		const gboolean	in_scope = qoi->scope == NULL || open_quick_row_in_scope(qoi, i);
+
+		if (qoi->scope != NULL && in_scope)
+			open_quick_scope_append(qoi, i);
+		if (qoi->filter_idle != 0 || !in_scope)
+			BITSET_CLEAR(qoi->index->visible, i);
+	}
+	if (qoi->filter_idle == 0)
+	{
+		const QuickOpenIndex	*idx = qoi->index;
+		gboolean		reshow = FALSE;
+		LDState			ld;
+
+		open_quick_filter_mask_update(qoi);
+		levenshtein_begin_half(&ld, qoi->filter_text);
+		for (guint32 i = first; i < idx->rows; i++)
+		{
+			if (qoi->scope != NULL && !open_quick_row_in_scope(qoi, i))
+				continue;
+			open_quick_filter_row(qoi, &ld, i);
+			if (BITSET_TEST(idx->visible, i) && (qoi->shown_rows < qoi->shown_max || open_quick_rank_compare(idx, i, qoi->shown[qoi->shown_rows - 1]) < 0))
+				reshow = TRUE;
+		}
+		levenshtein_end(&ld);
+		if (reshow || (open_quick_total(qoi) - qoi->files_filtered > qoi->shown_rows) != (gtk_tree_model_iter_n_children(GTK_TREE_MODEL(qoi->store), NULL) > (gint) qoi->shown_rows))
+			open_quick_reshow(qoi);
+		else
+			gtk_widget_queue_draw(qoi->view);	/* The "show more" row's count changed. */
+	}
+	open_quick_update_label(qoi);
+}
+
+/* Filters rows that were re-used or added by a refresh, and picks the rows to show again, since some may be gone.
+ * A filtering pass that's still running is simply started over, since it may be past some of the rows already.
+ * The same goes for a scoped dialog.
+*/
+static void open_quick_rows_changed(QuickOpenInfo *qoi, const guint32 *rows, guint32 num_rows)
+{
+	LDState	ld;
+
+	/* Re-used rows may have moved in or out of the scope; collecting it again means filtering it all again. */
+	if (qoi->scope != NULL)
+		qoi->scope_valid = FALSE;
+	if (qoi->filter_idle != 0 || qoi->scope != NULL)
+	{
+		open_quick_filter_start(qoi);
+		return;
+	}
+	qoi->filter_mask_rows = 0;	/* Re-used rows change the extension bitmaps without changing the row count. */
+	open_quick_filter_mask_update(qoi);
+	levenshtein_begin_half(&ld, qoi->filter_text);
+	for (guint32 i = 0; i < num_rows; i++)
+		open_quick_filter_row(qoi, &ld, rows[i]);
+	levenshtein_end(&ld);
+	open_quick_show(qoi, 0);
+	open_quick_update_label(qoi);
+}
+
+/* Returns the display's frame interval in microseconds, or a guess if the dialog isn't showing. */
+static gint64 open_quick_frame_interval(const QuickOpenInfo *qoi)
+{
+	GdkFrameClock	*clock = gtk_widget_get_frame_clock(qoi->view);
+	gint64		interval = 0;
+
+	if (clock != NULL)
+		gdk_frame_clock_get_refresh_info(clock, gdk_frame_clock_get_frame_time(clock), &interval, NULL);
+	return interval > 0 ? interval : G_USEC_PER_SEC / 60;
+}
+
+/* Filters the rows most likely to end up on the first page, so it can be shown before the pass has got to them. Typing
+ * mostly adds to the text, so the rows shown for the previous text are good bets, and recently committed files rank
+ * higher. The pass filters these again when it gets to them, and only counts them as filtered then.
+*/
+static void open_quick_filter_likely(QuickOpenInfo *qoi)
+{
+	const QuickOpenIndex	*idx = qoi->index;
+	const gulong		filtered = qoi->files_filtered;
+
+	for (guint32 i = 0; i < qoi->shown_rows; i++)
+	{
+		if (qoi->shown[i] < idx->rows && (qoi->scope == NULL || open_quick_row_in_scope(qoi, qoi->shown[i])))
+			open_quick_filter_row(qoi, &qoi->filter_ld, qoi->shown[i]);
+	}
+	/* A row that's been re-used since the recency was applied has lost it, and isn't likely any more. */
+	for (guint32 i = 0; i < idx->num_recent; i++)
+	{
+		const guint32	row = idx->recent[i];
+
+		if (row < idx->rows && idx->recency[row] != 0 && (qoi->scope == NULL || open_quick_row_in_scope(qoi, row)))
+			open_quick_filter_row(qoi, &qoi->filter_ld, row);
+	}
+	qoi->files_filtered = filtered;
+}
+
+/* Filters for one slice of time. The slice is what's left of a frame once the main loop has done its other work (mostly
+ * drawing), so the dialog keeps up with the display, but never more than the configured maximum. The first slice of a
+ * pass ends by showing the best matches so far, and more are shown as they're found until the list is full.
+*/
+static gboolean cb_open_quick_filter_idle(gpointer user)
+{
+	QuickOpenInfo		*qoi = user;
+	QuickOpenIndex		*idx = qoi->index;
+	const gint64		start = g_get_monotonic_time(), frame = open_quick_frame_interval(qoi);
+	const gint64		max_time = 1000 * (gint64) gitbrowser.quick_open_filter_max_time;
+	gulong			filtered;
+	guint32			limit, first_row, steps = 0;
+	gint64			slice, end;
+
+	/* Any keystrokes since the last slice are taken in one go. Switching between files and symbols starts a new pass. */
+	if (qoi->filter_pending)
+	{
+		qoi->filter_pending = FALSE;
+		open_quick_filter_changed(qoi);
+		if (qoi->index != idx)
+			return FALSE;
+	}
+	if (qoi->filter_slice_end == 0)
+		slice = frame / 2;
+	else
+		slice = (qoi->filter_slice + frame - (start - qoi->filter_slice_end)) / 2;
+	slice = MIN(MAX(slice, frame / 4), max_time);
+	qoi->filter_slice = slice;
+	end = start + slice;
+
+	open_quick_filter_mask_update(qoi);
+	if (qoi->filter_first)
+		open_quick_filter_likely(qoi);
+	/* Stream through the lower-case names, only touching the distance column for rows that match. When
+	 * filtering on extension, whole words of rows without any of the extensions are hidden in one go.
+	 * The clock is only read every so often, it's not free either.
+	*/
+	first_row = qoi->filter_row;
+	filtered = qoi->files_filtered;
+	limit = qoi->scope != NULL ? qoi->scope_num : idx->rows;
+	while (qoi->filter_row < limit && ((++steps & 63) != 0 || g_get_monotonic_time() < end))
+	{
+		if (qoi->scope != NULL)
+			open_quick_filter_row(qoi, &qoi->filter_ld, qoi->scope_rows[qoi->filter_row++]);
+		else if (qoi->filter_extensions != NULL && (qoi->filter_row & 31) == 0 && qoi->filter_mask[qoi->filter_row >> 5] == 0)
+		{
+			const guint32	skip = MIN(32, idx->rows - qoi->filter_row);
+
+			idx->visible[qoi->filter_row >> 5] = 0;
+			qoi->files_filtered += skip - bit_count(idx->dead[qoi->filter_row >> 5]);
+			qoi->filter_row += skip;
+		}
+		else
+			open_quick_filter_row(qoi, &qoi->filter_ld, qoi->filter_row++);
+	}
+	qoi->filter_slice_end = g_get_monotonic_time();
+	if (qoi->filter_row >= limit)
+	{
+		/* Done! Show the best matches, leaving the cursor where it is if a first page was already shown. */
+		qoi->filter_idle = 0;
+		if (qoi->filter_first)
+			open_quick_show(qoi, 0);
+		else
+			open_quick_reshow(qoi);
+		open_quick_update_label(qoi);
+		levenshtein_end(&qoi->filter_ld);
+		gtk_spinner_stop(GTK_SPINNER(qoi->spinner));
+		gtk_widget_hide(qoi->spinner);
+		return FALSE;
+	}
+	if (qoi->filter_first)
+		open_quick_show(qoi, 0);
+	else if (qoi->shown_rows < qoi->shown_max && qoi->filter_row - first_row > qoi->files_filtered - filtered)
+		open_quick_reshow(qoi);
+	qoi->filter_first = FALSE;
+	open_quick_update_label(qoi);
+	return TRUE;
+}
+
+/* (Re-)starts the filtering pass, in the background, with the current filter text. */
+static void open_quick_filter_start(QuickOpenInfo *qoi)
+{
+	levenshtein_begin_half(&qoi->filter_ld, qoi->filter_text);
+	qoi->files_filtered = 0;
+	qoi->filter_mask_rows = 0;
+	qoi->shown_max = gitbrowser.quick_open_max_rows;
+	/* Rows are hidden until the pass gets to them, so the matches found so far can be shown at any time. */
+	memset(qoi->index->visible, 0, BITSET_WORDS(qoi->index->rows) * sizeof *qoi->index->visible);
+	if (qoi->scope != NULL && !qoi->scope_valid)
+		open_quick_scope_build(qoi);
+	qoi->filter_first = TRUE;
+	qoi->filter_slice_end = 0;
+	gtk_spinner_start(GTK_SPINNER(qoi->spinner));
+	gtk_widget_show(qoi->spinner);
+
+	qoi->filter_row = 0;
+	if (qoi->filter_idle == 0)
+	{
+		qoi->filter_idle = g_idle_add(cb_open_quick_filter_idle, qoi);
+	}
+}
+
+/* Returns a pointer just past the group or class (opening bracket at <p>) that <p> starts, or at the terminator. */
+static const gchar * regex_skip_group(const gchar *p)
+{
+	const gchar	close = *p == '(' ? ')' : ']';
+
+	for (p++; *p != '\0' && *p != close; p++)
+	{
+		if (*p == '\\' && p[1] != '\0')
+			p++;
+		else if (close == ')' && (*p == '(' || *p == '['))
+		{
+			p = regex_skip_group(p);
+			if (*p == '\0')
+				return p;
+			p--;
+		}
+	}
+	return *p != '\0' ? p + 1 : p;
+}
+
+/* Checks for an escape that can take more than the one character after the backslash, like "\x41", "\cA", "\0101",
+ * "\g1" or "\k<name>". Only the single-letter classes, assertions and control characters are known to stand alone.
+*/
+static gboolean regex_has_long_escape(const gchar *pattern)
+{
+	for (const gchar *p = pattern; *p != '\0'; p++)
+	{
+		if (*p == '\\' && p[1] != '\0')
+		{
+			if (g_ascii_isalnum(p[1]) && strchr("dDwWsShHvVRXbBAzZGKaefnrt", p[1]) == NULL)
+				return TRUE;
+			p++;
+		}
+	}
+	return FALSE;
+}
+
+static void regex_end_literal(GString *run, GPtrArray *literals)
+{
+	if (run->len > 0)
+		g_ptr_array_add(literals, g_utf8_strdown(run->str, run->len));
+	g_string_truncate(run, 0);
+}
+
+/* Finds the literal strings that any match of <pattern> must contain, in lower case. It's conservative: groups,
+ * classes and anything optional are skipped, and any alternation makes nothing required. So do inline options
+ * like "(?x)", which can change what the rest means (extended mode drops the spaces), "\Q...\E" quoting, and
+ * escapes with arguments, whose digits or names aren't literal text.
+ * Finding too little only means the regex runs on more names; finding too much would hide files, so when in
+ * doubt, leave it out.
+*/
+static gchar ** regex_required_literals(const gchar *pattern)
+{
+	GPtrArray	*literals = g_ptr_array_new();
+	GString		*run = g_string_new(NULL);
+	const gchar	*p = pattern;
+
+	if (strchr(pattern, '|') != NULL || strstr(pattern, "(?") != NULL || strstr(pattern, "\\Q") != NULL || regex_has_long_escape(pattern))
+		p = "";
+	while (*p != '\0')
+	{
+		const gchar	*lit = p;
+		gsize		lit_len;
+
+		if (*p == '\\' && p[1] != '\0' && !g_ascii_isalnum(p[1]))
+		{
+			lit = p + 1;
+			lit_len = 1;
+			p += 2;
+		}
+		else if (*p == '\\' || *p == '(' || *p == '[' || strchr(".^$)*+?{}", *p) != NULL)
+		{
+			/* Not a literal, so whatever follows isn't adjacent to what came before. */
+			regex_end_literal(run, literals);
+			if (*p == '(' || *p == '[')
+				p = regex_skip_group(p);
+			else if (*p == '\\')
+				p += p[1] != '\0' ? 2 : 1;
+			else if (*p == '{')
+				p = (p = strchr(p, '}')) != NULL ? p + 1 : pattern + strlen(pattern);
+			else
+				p++;
+			continue;
+		}
+		else
+		{
+			lit_len = g_utf8_skip[*(const guchar *) p];
+			p += lit_len;
+		}
+		/* A quantifier allowing zero of the literal makes it optional; '+' means it's there, but ends the run. */
+		if (*p == '?' || *p == '*' || *p == '{')
+			regex_end_literal(run, literals);
+		else
+		{
+			g_string_append_len(run, lit, lit_len);
+			if (*p == '+')
+				regex_end_literal(run, literals);
+		}
+	}
+	regex_end_literal(run, literals);
+	g_string_free(run, TRUE);
+	g_ptr_array_add(literals, NULL);
+
+	return (gchar **) g_ptr_array_free(literals, FALSE);
+}
+
+/* Sets up the filter from the text in the entry. Without a prefix, the text is space-separated terms, which
+ * must all be in a name for it to match. A term starting with '!' must not be. A single term is looked for
+ * with a plain strstr(), several go into an Aho-Corasick automaton so each name is scanned only once.
+*/
+static void open_quick_filter_parse(QuickOpenInfo *qoi, const gchar *filter)
+{
+	gchar	*filter_lower;
+
+	/* A leading '@' means symbols. */
+	if ((qoi->symbols = filter[0] == '@'))
+		filter++;
+	if (qoi->filter_regex != NULL)
+	{
+		g_regex_unref(qoi->filter_regex);
+		qoi->filter_regex = NULL;
+		g_strfreev(qoi->filter_literals);
+		qoi->filter_literals = NULL;
+	}
+	if (qoi->filter_ac != NULL)
+	{
+		ahocorasick_free(qoi->filter_ac);
+		qoi->filter_ac = NULL;
+		open_quick_filter_spill_clear(qoi);
+	}
+	g_strfreev(qoi->filter_extensions);
+	qoi->filter_extensions = NULL;
+	qoi->filter_invalid = FALSE;
+	/* Then a '/' means the rest is a regex. It's compiled once, here, and matched case-insensitively like plain text. */
+	if (filter[0] == '/')
+	{
+		filter++;
+		if (filter[0] != '\0')
+		{
+			if ((qoi->filter_regex = g_regex_new(filter, G_REGEX_OPTIMIZE | G_REGEX_CASELESS, 0, NULL)) != NULL)
+				qoi->filter_literals = regex_required_literals(filter);
+			else
+				qoi->filter_invalid = TRUE;
+		}
+		g_strlcpy(qoi->filter_text, filter, sizeof qoi->filter_text);
+		filter_lower = g_utf8_strdown(filter, -1);
+		g_strlcpy(qoi->filter_lower, filter_lower, sizeof qoi->filter_lower);
+		g_free(filter_lower);
+	}
+	else
+	{
+		gchar		**terms = g_strsplit(filter, " ", -1), *lower[AHOCORASICK_MAX_PATTERNS];
+		guint		num_terms = 0;
+		GPtrArray	*extensions = g_ptr_array_new();
+
+		qoi->filter_text[0] = qoi->filter_lower[0] = '\0';
+		qoi->filter_need = qoi->filter_reject = 0;
+		for (gchar **t = terms; *t != NULL && num_terms < G_N_ELEMENTS(lower); t++)
+		{
+			const gboolean	negative = (*t)[0] == '!';
+			const gchar	*term = *t + (negative ? 1 : 0);
+
+			if (term[0] == '\0')
+				continue;
+			/* A "*.ext" term picks rows by extension, from the index's bitmaps, rather than by name. */
+			if (!negative && term[0] == '*' && term[1] == '.' && term[2] != '\0')
+			{
+				g_ptr_array_add(extensions, g_utf8_strdown(term + 2, -1));
+				continue;
+			}
+			/* Rank by the first wanted term. */
+			if (!negative && qoi->filter_need == 0)
+				g_strlcpy(qoi->filter_text, term, sizeof qoi->filter_text);
+			if (negative)
+				qoi->filter_reject |= 1u << num_terms;
+			else
+				qoi->filter_need |= 1u << num_terms;
+			lower[num_terms++] = g_utf8_strdown(term, -1);
+		}
+		if (num_terms > 1 || qoi->filter_reject != 0)
+		{
+			qoi->filter_ac = ahocorasick_new((const gchar * const *) lower, num_terms);
+			/* Very long terms may not all fit. The automaton can't tell about those, so they're kept to look for as they are. */
+			qoi->filter_spilled = (qoi->filter_need | qoi->filter_reject) & ~ahocorasick_patterns(qoi->filter_ac);
+			for (guint i = 0; i < num_terms; i++)
+			{
+				if (qoi->filter_spilled & (1u << i))
+				{
+					qoi->filter_spill[i] = lower[i];
+					lower[i] = NULL;
+				}
+			}
+		}
+		else if (num_terms == 1)
+			g_strlcpy(qoi->filter_lower, lower[0], sizeof qoi->filter_lower);
+		for (guint i = 0; i < num_terms; i++)
+			g_free(lower[i]);
+		g_strfreev(terms);
+		if (extensions->len > 0)
+		{
+			g_ptr_array_add(extensions, NULL);
+			qoi->filter_extensions = (gchar **) g_ptr_array_free(extensions, FALSE);
+		}
+		else
+			g_ptr_array_free(extensions, TRUE);
+	}
+}
+
+/* Takes in the entry's text, and starts filtering with it. */
+static void open_quick_filter_changed(QuickOpenInfo *qoi)
+{
+	open_quick_filter_parse(qoi, gtk_entry_buffer_get_text(gtk_entry_get_buffer(GTK_ENTRY(qoi->entry))));
+
+	if (qoi->repo != NULL)
+	{
+		Repository	*repo = qoi->repo;
+		QuickOpenIndex	*want = qoi->symbols ? repository_get_symbols(repo) : repository_get_quick_open(repo);
+
+		/* Switching between files and symbols re-populates the list, which also starts filtering it. */
+		if (want != qoi->index)
+		{
+			open_quick_attach(qoi, repo, want);
+			return;
+		}
+	}
+	if (qoi->index != NULL)
+		open_quick_filter_start(qoi);
+}
+
+static void evt_open_quick_entry_changed(GtkWidget *wid, gpointer user)
+{
+	QuickOpenInfo	*qoi = user;
+	const gchar	*filter = gtk_entry_buffer_get_text(gtk_entry_get_buffer(GTK_ENTRY(wid)));
+
+	gtk_entry_set_icon_sensitive(GTK_ENTRY(wid), GTK_ENTRY_ICON_SECONDARY, filter[0] != '\0');
+	/* Typing faster than a pass runs would keep restarting it; let the next slice pick up the change instead. */
+	if (qoi->filter_idle != 0)
+		qoi->filter_pending = TRUE;
+	else
+		open_quick_filter_changed(qoi);
+}
+
+static void evt_open_quick_entry_icon_release(GtkWidget *wid, GtkEntryIconPosition position, GdkEvent *evt, gpointer user)
+{
+	gtk_entry_set_text(GTK_ENTRY(wid), "");	/* There's only one icon, so no need to figure out which was clicked. */
+}
+
+static gboolean evt_open_quick_entry_key_press(GtkWidget *wid, GdkEventKey *evt, gpointer user)
+{
+	QuickOpenInfo	*qoi = user;
+
+	if (evt->type == GDK_KEY_PRESS)
+	{
+		/* This is, unfortunately, something of a hack: to make cursor up/down keys
+		 * in the entry affect the selection in the tree view, we copy the event,
+		 * poke the window member, and re-emit it. The best thing is that it works.
+		 *
+		 * FIXME: There should be a better way of implementing this. Find it.
+		*/
+		if (evt->keyval == GDK_KEY_Up || evt->keyval == GDK_KEY_Down ||
+		   evt->keyval == GDK_KEY_Page_Up || evt->keyval == GDK_KEY_Page_Down)
+		{
+			GdkEventKey	copy = *evt;
+
+			copy.window = gtk_widget_get_window(qoi->view);
+			copy.send_event = TRUE;
+			gtk_widget_grab_focus(qoi->view);
+			gtk_main_do_event((GdkEvent *) &copy);
+			gtk_widget_grab_focus(wid);
+
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void cdf_open_quick_filename(GtkTreeViewColumn *tree_column, GtkCellRenderer *cell, GtkTreeModel *model, GtkTreeIter *iter, gpointer user)
+{
+	const QuickOpenInfo	*qoi = user;
+	guint			row;
+
+	gtk_tree_model_get(model, iter, QO_ROW, &row, -1);
+	if (row == QO_ROW_MORE)
+	{
+		gchar	buf[128];
+
+		g_snprintf(buf, sizeof buf, _("Show more (%lu not shown)"), (unsigned long) (open_quick_total(qoi) - qoi->files_filtered - qoi->shown_rows));
+		g_object_set(G_OBJECT(cell), "text", buf, "style", PANGO_STYLE_ITALIC, NULL);
+	}
+	else
+		g_object_set(G_OBJECT(cell), "text", strtab_get(&qoi->index->names, qoi->index->name[row]), "style", PANGO_STYLE_NORMAL, NULL);
+}
+
+static void cdf_open_quick_location(GtkTreeViewColumn *tree_column, GtkCellRenderer *cell, GtkTreeModel *model, GtkTreeIter *iter, gpointer user)
+{
+	const QuickOpenInfo	*qoi = user;
+	guint			row;
+
+	gtk_tree_model_get(model, iter, QO_ROW, &row, -1);
+	if (row == QO_ROW_MORE)
+		g_object_set(G_OBJECT(cell), "text", "", NULL);
+	else if (qoi->index->line != NULL)
+	{
+		gchar	buf[1024];
+
+		g_snprintf(buf, sizeof buf, "%s%s%s:%u", strtab_get(&qoi->index->names, qoi->index->path[row]), G_DIR_SEPARATOR_S,
+				strtab_get(&qoi->index->names, qoi->index->file[row]), qoi->index->line[row]);
+		g_object_set(G_OBJECT(cell), "text", buf, NULL);
+	}
+	else
+		g_object_set(G_OBJECT(cell), "text", strtab_get(&qoi->index->names, qoi->index->path[row]), NULL);
+}
+
+/* Stops showing the current repository's list; the dialog holds no references to it after this. */
+static void open_quick_detach(QuickOpenInfo *qoi)
+{
+	if (qoi->filter_pending)
+	{
+		qoi->filter_pending = FALSE;
+		open_quick_filter_parse(qoi, gtk_entry_buffer_get_text(gtk_entry_get_buffer(GTK_ENTRY(qoi->entry))));
+	}
+	if (qoi->filter_idle != 0)
+	{
+		g_source_remove(qoi->filter_idle);
+		qoi->filter_idle = 0;
+		levenshtein_end(&qoi->filter_ld);
+		gtk_spinner_stop(GTK_SPINNER(qoi->spinner));
+		gtk_widget_hide(qoi->spinner);
+	}
+	if (qoi->store != NULL)
+		gtk_list_store_clear(qoi->store);
+	qoi->shown_rows = 0;
+	qoi->filter_mask_rows = 0;
+	qoi->repo = NULL;
+	qoi->index = NULL;
+	qoi->files_filtered = 0;
+	qoi->scope_valid = FALSE;
+	open_quick_preview_stop(qoi);
+	if (qoi->preview != NULL)
+		gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(qoi->preview)), "", -1);
+}
+
+/* Points the dialog at a repository's list, and filters it with whatever is in the entry. */
+static void open_quick_attach(QuickOpenInfo *qoi, Repository *repo, QuickOpenIndex *idx)
+{
+	open_quick_detach(qoi);
+	qoi->repo = repo;
+	qoi->index = idx;
+	open_quick_filter_start(qoi);
+}
+
+static void open_quick_dialog_create(QuickOpenInfo *qoi)
+{
+	GtkWidget		*vbox, *label, *scwin, *title, *hbox, *paned;
+	GtkCellRenderer         *cr;
+	GtkTreeViewColumn       *vc;
+
+	qoi->store = gtk_list_store_new(QO_NUM_COLUMNS, G_TYPE_UINT);
+
+	qoi->dialog = gtk_dialog_new_with_buttons("", NULL, GTK_DIALOG_MODAL, "_OK", GTK_RESPONSE_OK, "_Cancel", GTK_RESPONSE_CANCEL, NULL);
+	gtk_dialog_set_default_response(GTK_DIALOG(qoi->dialog), GTK_RESPONSE_OK);
+	gtk_window_set_default_size(GTK_WINDOW(qoi->dialog), 600, 600);
+
+	vbox = ui_dialog_vbox_new(GTK_DIALOG(qoi->dialog));
+	label = gtk_label_new(_("Select one or more document(s) to open. Type words to filter filenames ('!word' to exclude, '*.ext' to pick by extension), start with '/' for a regular expression, or with '@' to find symbols."));
+	gtk_box_pack_start(GTK_BOX(vbox), label, FALSE, FALSE, 0);
+	/* Create a label showing filtering status. */
+	hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+	qoi->spinner = gtk_spinner_new();
+	gtk_box_pack_start(GTK_BOX(hbox), qoi->spinner, FALSE, FALSE, 0);
+	qoi->label = gtk_label_new("");
+	gtk_box_pack_start(GTK_BOX(hbox), qoi->label, TRUE, TRUE, 0);
+	open_quick_update_label(qoi);
+	gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+	gtk_widget_show_all(hbox);
+	gtk_widget_hide(qoi->spinner);
+	qoi->view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(qoi->store));
+
+	vc = gtk_tree_view_column_new();
+	cr = gtk_cell_renderer_text_new();
+	title = gtk_label_new(_("Filename"));
+	gtk_widget_show(title);
+	gtk_tree_view_column_set_widget(vc, title);
+	/* All rows are the same height, so let the view skip measuring them. That needs fixed-size columns. */
+	gtk_tree_view_column_set_sizing(vc, GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_fixed_width(vc, 200);
+	gtk_tree_view_column_set_resizable(vc, TRUE);
+	gtk_tree_view_append_column(GTK_TREE_VIEW(qoi->view), vc);
+	gtk_tree_view_column_pack_start(vc, cr, TRUE);
+	gtk_tree_view_column_set_cell_data_func(vc, cr, cdf_open_quick_filename, qoi, NULL);
+
+	vc = gtk_tree_view_column_new();
+	cr = gtk_cell_renderer_text_new();
+	title = gtk_label_new(_("Location"));
+	gtk_widget_show(title);
+	gtk_tree_view_column_set_widget(vc, title);
+	gtk_tree_view_column_set_sizing(vc, GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_expand(vc, TRUE);
+	gtk_tree_view_append_column(GTK_TREE_VIEW(qoi->view), vc);
+	gtk_tree_view_column_pack_start(vc, cr, TRUE);
+	gtk_tree_view_column_set_cell_data_func(vc, cr, cdf_open_quick_location, qoi, NULL);
+	gtk_tree_view_set_headers_clickable(GTK_TREE_VIEW(qoi->view), FALSE);
+	gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(qoi->view), TRUE);
+
+	scwin = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scwin), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+	g_signal_connect(G_OBJECT(qoi->view), "row_activated", G_CALLBACK(evt_open_quick_view_row_activated), qoi);
+	gtk_container_add(GTK_CONTAINER(scwin), qoi->view);
+	paned = gtk_paned_new(GTK_ORIENTATION_HORIZONTAL);
+	gtk_paned_pack1(GTK_PANED(paned), scwin, TRUE, FALSE);
+	qoi->preview = gtk_text_view_new();
+	gtk_text_view_set_editable(GTK_TEXT_VIEW(qoi->preview), FALSE);
+	gtk_text_view_set_cursor_visible(GTK_TEXT_VIEW(qoi->preview), FALSE);
+	gtk_text_view_set_monospace(GTK_TEXT_VIEW(qoi->preview), TRUE);
+	qoi->preview_box = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(qoi->preview_box), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+	gtk_container_add(GTK_CONTAINER(qoi->preview_box), qoi->preview);
+	gtk_paned_pack2(GTK_PANED(paned), qoi->preview_box, TRUE, TRUE);
+	gtk_box_pack_start(GTK_BOX(vbox), paned, TRUE, TRUE, 0);
+	qoi->entry = gtk_entry_new();
+	gtk_entry_set_activates_default(GTK_ENTRY(qoi->entry), TRUE);
+	gtk_entry_set_icon_from_icon_name(GTK_ENTRY(qoi->entry), GTK_ENTRY_ICON_SECONDARY, "edit-clear");
+	gtk_entry_set_icon_sensitive(GTK_ENTRY(qoi->entry), GTK_ENTRY_ICON_SECONDARY, FALSE);
+	g_signal_connect(G_OBJECT(qoi->entry), "changed", G_CALLBACK(evt_open_quick_entry_changed), qoi);
+	g_signal_connect(G_OBJECT(qoi->entry), "key-press-event", G_CALLBACK(evt_open_quick_entry_key_press), qoi);
+	g_signal_connect(G_OBJECT(qoi->entry), "icon-release", G_CALLBACK(evt_open_quick_entry_icon_release), qoi);
+	gtk_box_pack_start(GTK_BOX(vbox), qoi->entry, FALSE, FALSE, 0);
+
+	gtk_dialog_set_response_sensitive(GTK_DIALOG(qoi->dialog), GTK_RESPONSE_OK, FALSE);
+
+	gtk_widget_show_all(vbox);
+
+	qoi->selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(qoi->view));
+	gtk_tree_selection_set_mode(qoi->selection, GTK_SELECTION_MULTIPLE);
+	g_signal_connect(G_OBJECT(qoi->selection), "changed", G_CALLBACK(evt_open_quick_selection_changed), qoi);
+}
+
+void repository_open_quick(Repository *repo)
+{
+	repository_open_quick_in(repo, NULL);
+}
+
+/* Sets the directory the dialog looks in, as a path relative to the repository root with '/' separators. */
+static gboolean open_quick_set_scope(QuickOpenInfo *qoi, const Repository *repo, const gchar *dir)
+{
+	gchar	*prefix = dir != NULL && dir[0] != '\0' ? g_strconcat(dir, "/", NULL) : NULL;
+
+	if (g_strcmp0(prefix, qoi->scope_prefix) == 0)
+	{
+		g_free(prefix);
+		return FALSE;
+	}
+	g_free(qoi->scope);
+	g_free(qoi->scope_prefix);
+	qoi->scope = NULL;
+	qoi->scope_prefix = prefix;
+	if (prefix != NULL)
+	{
+		gchar	*fs = g_strdup_printf("%s%s%s", repo->root_path, G_DIR_SEPARATOR_S, dir);
+
+		g_strdelimit(fs, "/", G_DIR_SEPARATOR);
+		qoi->scope = g_filename_display_name(fs);
+		g_free(fs);
+	}
+	qoi->scope_valid = FALSE;
+	return TRUE;
+}
+
+/* Runs the Quick Open dialog for a repository. If <dir> is given, it's limited to the files (or symbols) in that
+ * directory, which is relative to the repository root and uses '/' as separator, just like git.
+*/
+void repository_open_quick_in(Repository *repo, const gchar *dir)
+{
+	QuickOpenInfo	*qoi = &gitbrowser.quick_open;
+	QuickOpenIndex	*idx;
+	gchar		tbuf[1024];
+	gint		response;
+
+	if (repo == NULL)
+	{
+		msgwin_status_add(_("Current document is not part of a known repository. Use Add to add a repository."));
+		return;
+	}
+	if (qoi->dialog == NULL)
+		open_quick_dialog_create(qoi);
+	idx = qoi->symbols ? repository_get_symbols(repo) : repository_get_quick_open(repo);
+	if (qoi->repo != repo || qoi->index != idx)
+	{
+		open_quick_set_scope(qoi, repo, dir);
+		open_quick_attach(qoi, repo, idx);
+	}
+	else if (open_quick_set_scope(qoi, repo, dir))
+		open_quick_filter_start(qoi);
+
+	if (dir != NULL && dir[0] != '\0')
+		g_snprintf(tbuf, sizeof tbuf, _("Quick Open in \"%s\" of Git Repository \"%s\""), dir, repository_get_name(repo));
+	else
+		g_snprintf(tbuf, sizeof tbuf, _("Quick Open in Git Repository \"%s\""), repository_get_name(repo));
+	gtk_window_set_title(GTK_WINDOW(qoi->dialog), tbuf);
+	gtk_widget_set_visible(qoi->preview_box, gitbrowser.quick_open_preview);
+	open_quick_preview_start(qoi);
+	gtk_editable_select_region(GTK_EDITABLE(qoi->entry), 0, -1);
+	gtk_widget_grab_focus(qoi->entry);
+	/* Accepting the "show more" row shows more, rather than closing the dialog. */
+	while ((response = gtk_dialog_run(GTK_DIALOG(qoi->dialog))) == GTK_RESPONSE_OK && open_quick_more_selected(qoi))
+		open_quick_show_more(qoi);
+	if (response == GTK_RESPONSE_OK)
+	{
+		GList	*selection = gtk_tree_selection_get_selected_rows(qoi->selection, NULL), *iter;
+
+		for (iter = selection; iter != NULL; iter = g_list_next(iter))
+		{
+			GtkTreeIter	here;
+
+			if (gtk_tree_model_get_iter(GTK_TREE_MODEL(qoi->store), &here, iter->data))
+			{
+				gchar	buf[2048], *fn;
+				guint	row;
+
+				gtk_tree_model_get(GTK_TREE_MODEL(qoi->store), &here, QO_ROW, &row, -1);
+				if (row != QO_ROW_MORE && open_quick_row_filename(qoi, row, buf, sizeof buf))
+				{
+					if ((fn = g_filename_from_utf8(buf, -1, NULL, NULL, NULL)) != NULL)
+					{
+						GeanyDocument	*old_doc = document_get_current(), *doc;
+
+						doc = document_open_file(buf, FALSE, NULL, NULL);
+						if (doc != NULL && qoi->index->line != NULL)
+							navqueue_goto_line(old_doc, doc, (gint) qoi->index->line[row]);
+						g_free(fn);
+					}
+				}
+			}
+		}
+		g_list_foreach(selection, (GFunc) gtk_tree_path_free, NULL);
+		g_list_free(selection);
+	}
+	open_quick_preview_stop(qoi);
+	gtk_widget_hide(qoi->dialog);
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+static void sidebar_model_tree_model_init(GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE(SidebarModel, sidebar_model, G_TYPE_OBJECT, G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL, sidebar_model_tree_model_init))
+
+#define	SIDEBAR_MODEL(o)	(G_TYPE_CHECK_INSTANCE_CAST((o), sidebar_model_get_type(), SidebarModel))
+
+static void sidebar_model_init(SidebarModel *sm)
+{
+	sm->stamp = g_random_int();
+	sm->rows = g_array_new(FALSE, FALSE, sizeof (SidebarRow));
+}
+
+static void sidebar_model_finalize(GObject *object)
+{
+	SidebarModel	*sm = SIDEBAR_MODEL(object);
+
+	for (guint i = 0; i < sm->rows->len; i++)
+		g_free(g_array_index(sm->rows, SidebarRow, i).label);
+	g_array_free(sm->rows, TRUE);
+	G_OBJECT_CLASS(sidebar_model_parent_class)->finalize(object);
+}
+
+static void sidebar_model_class_init(SidebarModelClass *klass)
+{
+	G_OBJECT_CLASS(klass)->finalize = sidebar_model_finalize;
+}
+
+/* The top row has no data in the iterator at all. */
+static void sidebar_model_iter_top(const SidebarModel *sm, GtkTreeIter *iter)
+{
+	iter->stamp = sm->stamp;
+	iter->user_data = iter->user_data2 = iter->user_data3 = NULL;
+}
+
+/* A repository or separator has its repository (if any) and 1 + its index in the rows. */
+static void sidebar_model_iter_row(const SidebarModel *sm, GtkTreeIter *iter, guint row)
+{
+	iter->stamp = sm->stamp;
+	iter->user_data = g_array_index(sm->rows, SidebarRow, row).repo;
+	iter->user_data2 = NULL;
+	iter->user_data3 = GUINT_TO_POINTER(row + 1);
+}
+
+/* A file or directory has its repository, and its node in the repository's tree (never 0, that's the repository itself). */
+static void sidebar_model_iter_node(const SidebarModel *sm, GtkTreeIter *iter, Repository *repo, guint32 node)
+{
+	iter->stamp = sm->stamp;
+	iter->user_data = repo;
+	iter->user_data2 = GUINT_TO_POINTER(node);
+	iter->user_data3 = NULL;
+}
+
+#define	SIDEBAR_ITER_NODE(i)	GPOINTER_TO_UINT((i)->user_data2)
+#define	SIDEBAR_ITER_ROW(i)	GPOINTER_TO_UINT((i)->user_data3)
+
+/* Iterators are good until the rows they could point at change; see sidebar_model_invalidate(). */
+#define	SIDEBAR_ITER_VALID(sm, i)	((i) != NULL && (i)->stamp == (sm)->stamp)
+
+/* Makes every iterator given out so far invalid, for when the rows or trees behind them have changed. */
+static void sidebar_model_invalidate(SidebarModel *sm)
+{
+	do
+		sm->stamp++;
+	while (sm->stamp == 0);
+}
+
+/* Returns the tree node whose children are under a row, or 0 if there are none; for a repository that's its root. */
+static guint32 sidebar_model_first_child(const GtkTreeIter *iter)
+{
+	const Repository	*repo = iter->user_data;
+
+	if (repo == NULL || repo->tree.nodes == NULL)
+		return 0;
+	return repo->tree.nodes[SIDEBAR_ITER_NODE(iter)].first_child;
+}
+
+/* Finds a repository's index in the rows. There are only ever a handful. */
+static guint sidebar_model_find_row(const SidebarModel *sm, const Repository *repo)
+{
+	guint	row = 0;
+
+	while (row < sm->rows->len && g_array_index(sm->rows, SidebarRow, row).repo != repo)
+		row++;
+	return row;
+}
+
+static GtkTreeModelFlags sidebar_model_get_flags(GtkTreeModel *model)
+{
+	return 0;
+}
+
+static gint sidebar_model_get_n_columns(GtkTreeModel *model)
+{
+	return 2;
+}
+
+static GType sidebar_model_get_column_type(GtkTreeModel *model, gint column)
+{
+	return column == 0 ? G_TYPE_STRING : G_TYPE_POINTER;
+}
+
+static gboolean sidebar_model_iter_nth_child(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent, gint n)
+{
+	const SidebarModel	*sm = SIDEBAR_MODEL(model);
+
+	g_return_val_if_fail(parent == NULL || SIDEBAR_ITER_VALID(sm, parent), FALSE);
+	if (parent == NULL)
+	{
+		if (n != 0)
+			return FALSE;
+		sidebar_model_iter_top(sm, iter);
+	}
+	else if (parent->user_data == NULL && SIDEBAR_ITER_ROW(parent) == 0)
+	{
+		if (n < 0 || (guint) n >= sm->rows->len)
+			return FALSE;
+		sidebar_model_iter_row(sm, iter, n);
+	}
+	else
+	{
+		const Repository	*repo = parent->user_data;
+		guint32			child = sidebar_model_first_child(parent);
+
+		if (n < 0)
+			return FALSE;
+		if (child != 0 && repo->tree.contiguous)
+			child = (guint) n < repo->tree.num_nodes - child && repo->tree.nodes[child + n].parent == SIDEBAR_ITER_NODE(parent) ? child + n : 0;
+		else
+		{
+			for (; child != 0 && n > 0; n--)
+				child = repo->tree.nodes[child].next_sibling;
+		}
+		if (child == 0)
+			return FALSE;
+		sidebar_model_iter_node(sm, iter, parent->user_data, child);
+	}
+	return TRUE;
+}
+
+static gboolean sidebar_model_get_iter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	gint		depth;
+	const gint	*indices = gtk_tree_path_get_indices_with_depth(path, &depth);
+	GtkTreeIter	parent;
+
+	if (depth < 1 || !sidebar_model_iter_nth_child(model, iter, NULL, indices[0]))
+		return FALSE;
+	for (gint i = 1; i < depth; i++)
+	{
+		parent = *iter;
+		if (!sidebar_model_iter_nth_child(model, iter, &parent, indices[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static GtkTreePath * sidebar_model_get_path(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	const SidebarModel	*sm = SIDEBAR_MODEL(model);
+	GtkTreePath		*path;
+	guint			row = SIDEBAR_ITER_ROW(iter);
+
+	g_return_val_if_fail(SIDEBAR_ITER_VALID(sm, iter), NULL);
+	path = gtk_tree_path_new();
+	if (SIDEBAR_ITER_NODE(iter) != 0)
+	{
+		const Repository	*repo = iter->user_data;
+		const FileNode		*nodes = repo->tree.nodes;
+
+		/* Each node's index is its position among its siblings, counted from the parent's first child. In a finished
+		 * tree that's just the difference; only while a refresh is being merged in do the links need following.
+		*/
+		for (guint32 node = SIDEBAR_ITER_NODE(iter); node != 0; node = nodes[node].parent)
+		{
+			gint	index = 0;
+
+			if (repo->tree.contiguous)
+				index = node - nodes[nodes[node].parent].first_child;
+			else
+			{
+				for (guint32 sibling = nodes[nodes[node].parent].first_child; sibling != node; sibling = nodes[sibling].next_sibling)
+					index++;
+			}
+			gtk_tree_path_prepend_index(path, index);
+		}
+		row = sidebar_model_find_row(sm, repo) + 1;
+	}
+	if (row != 0)
+		gtk_tree_path_prepend_index(path, row - 1);
+	gtk_tree_path_prepend_index(path, 0);
+	return path;
+}
+
+/* The strings aren't copied into the value; they last as long as the row does. */
+static void sidebar_model_get_value(GtkTreeModel *model, GtkTreeIter *iter, gint column, GValue *value)
+{
+	const SidebarModel	*sm = SIDEBAR_MODEL(model);
+
+	g_return_if_fail(SIDEBAR_ITER_VALID(sm, iter));
+	g_value_init(value, sidebar_model_get_column_type(model, column));
+	if (SIDEBAR_ITER_NODE(iter) != 0)
+	{
+		const Repository	*repo = iter->user_data;
+
+		if (column == 0)
+			g_value_set_static_string(value, file_tree_get_display(&repo->tree, repo->files.buffer, SIDEBAR_ITER_NODE(iter)));
+		else
+			g_value_set_pointer(value, repo->files.buffer + repo->tree.nodes[SIDEBAR_ITER_NODE(iter)].name);
+	}
+	else if (SIDEBAR_ITER_ROW(iter) != 0)
+	{
+		const SidebarRow	*row = &g_array_index(sm->rows, SidebarRow, SIDEBAR_ITER_ROW(iter) - 1);
+
+		if (column == 0)
+			g_value_set_static_string(value, row->label);
+		else
+			g_value_set_pointer(value, row->repo != NULL ? row->repo->root_path : NULL);
+	}
+	else if (column == 0)
+		g_value_set_static_string(value, _("Repositories (Right-click to add)"));
+}
+
+static gboolean sidebar_model_iter_next(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	const SidebarModel	*sm = SIDEBAR_MODEL(model);
+
+	g_return_val_if_fail(SIDEBAR_ITER_VALID(sm, iter), FALSE);
+	if (SIDEBAR_ITER_NODE(iter) != 0)
+	{
+		const Repository	*repo = iter->user_data;
+		const guint32		next = repo->tree.nodes[SIDEBAR_ITER_NODE(iter)].next_sibling;
+
+		if (next != 0)
+		{
+			iter->user_data2 = GUINT_TO_POINTER(next);
+			return TRUE;
+		}
+	}
+	else if (SIDEBAR_ITER_ROW(iter) != 0 && SIDEBAR_ITER_ROW(iter) < sm->rows->len)
+	{
+		sidebar_model_iter_row(sm, iter, SIDEBAR_ITER_ROW(iter));
+		return TRUE;
+	}
+	iter->stamp = 0;
+	return FALSE;
+}
+
+static gboolean sidebar_model_iter_children(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	return sidebar_model_iter_nth_child(model, iter, parent, 0);
+}
+
+static gboolean sidebar_model_iter_has_child(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	g_return_val_if_fail(SIDEBAR_ITER_VALID(SIDEBAR_MODEL(model), iter), FALSE);
+	if (iter->user_data == NULL && SIDEBAR_ITER_ROW(iter) == 0)
+		return SIDEBAR_MODEL(model)->rows->len > 0;
+	return sidebar_model_first_child(iter) != 0;
+}
+
+static gint sidebar_model_iter_n_children(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	gint	count = 0;
+
+	if (iter == NULL)
+		return 1;
+	g_return_val_if_fail(SIDEBAR_ITER_VALID(SIDEBAR_MODEL(model), iter), 0);
+	if (iter->user_data == NULL && SIDEBAR_ITER_ROW(iter) == 0)
+		return SIDEBAR_MODEL(model)->rows->len;
+	for (guint32 child = sidebar_model_first_child(iter); child != 0; child = ((const Repository *) iter->user_data)->tree.nodes[child].next_sibling)
+		count++;
+	return count;
+}
+
+static gboolean sidebar_model_iter_parent(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	const SidebarModel	*sm = SIDEBAR_MODEL(model);
+
+	g_return_val_if_fail(SIDEBAR_ITER_VALID(sm, child), FALSE);
+	if (SIDEBAR_ITER_NODE(child) != 0)
+	{
+		Repository	*repo = child->user_data;
+		const guint32	parent = repo->tree.nodes[SIDEBAR_ITER_NODE(child)].parent;
+
+		if (parent != 0)
+			sidebar_model_iter_node(sm, iter, repo, parent);
+		else
+			sidebar_model_iter_row(sm, iter, sidebar_model_find_row(sm, repo));
+		return TRUE;
+	}
+	if (SIDEBAR_ITER_ROW(child) != 0)
+	{
+		sidebar_model_iter_top(sm, iter);
+		return TRUE;
+	}
+	iter->stamp = 0;
+	return FALSE;
+}
+
+static void sidebar_model_tree_model_init(GtkTreeModelIface *iface)
+{
+	iface->get_flags = sidebar_model_get_flags;
+	iface->get_n_columns = sidebar_model_get_n_columns;
+	iface->get_column_type = sidebar_model_get_column_type;
+	iface->get_iter = sidebar_model_get_iter;
+	iface->get_path = sidebar_model_get_path;
+	iface->get_value = sidebar_model_get_value;
+	iface->iter_next = sidebar_model_iter_next;
+	iface->iter_children = sidebar_model_iter_children;
+	iface->iter_has_child = sidebar_model_iter_has_child;
+	iface->iter_n_children = sidebar_model_iter_n_children;
+	iface->iter_nth_child = sidebar_model_iter_nth_child;
+	iface->iter_parent = sidebar_model_iter_parent;
+}
+
+/* First column is display text, second is corresponding path (or path part). All are NULL for separators. Neither is
+ * copied, see sidebar_model_get_value() and tree_model_get_full_path().
+*/
+GtkTreeModel * tree_model_new(void)
+{
+	return g_object_new(sidebar_model_get_type(), NULL);
+}
+
+/* Adds a repository (or with <repo> NULL, a separator) at the end, setting <iter> to its row. */
+static void tree_model_append(GtkTreeModel *model, Repository *repo, const gchar *label, GtkTreeIter *iter)
+{
+	SidebarModel		*sm = SIDEBAR_MODEL(model);
+	const SidebarRow	row = { repo, g_strdup(label) };
+	GtkTreeIter		top;
+	GtkTreePath		*path;
+
+	g_array_append_val(sm->rows, row);
+	sidebar_model_iter_row(sm, iter, sm->rows->len - 1);
+	path = gtk_tree_model_get_path(model, iter);
+	gtk_tree_model_row_inserted(model, path, iter);
+	gtk_tree_path_free(path);
+	if (sm->rows->len == 1)
+	{
+		sidebar_model_iter_top(sm, &top);
+		path = gtk_tree_path_new_first();
+		gtk_tree_model_row_has_child_toggled(model, path, &top);
+		gtk_tree_path_free(path);
+	}
+	if (sidebar_model_first_child(iter) != 0)
+	{
+		path = gtk_tree_model_get_path(model, iter);
+		gtk_tree_model_row_has_child_toggled(model, path, iter);
+		gtk_tree_path_free(path);
+	}
+}
+
+static void tree_model_set_label(GtkTreeModel *model, GtkTreeIter *iter, const gchar *label)
+{
+	SidebarRow	*row = &g_array_index(SIDEBAR_MODEL(model)->rows, SidebarRow, SIDEBAR_ITER_ROW(iter) - 1);
+	GtkTreePath	*path;
+
+	g_free(row->label);
+	row->label = g_strdup(label);
+	path = gtk_tree_model_get_path(model, iter);
+	gtk_tree_model_row_changed(model, path, iter);
+	gtk_tree_path_free(path);
+}
+
+/* Removes a repository's (or separator's) row. The repository itself is left alone, but shouldn't outlive the row by much. */
+static void tree_model_remove(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	SidebarModel	*sm = SIDEBAR_MODEL(model);
+	const guint	row = SIDEBAR_ITER_ROW(iter) - 1;
+	GtkTreePath	*path = gtk_tree_model_get_path(model, iter);
+	GtkTreeIter	top;
+
+	g_free(g_array_index(sm->rows, SidebarRow, row).label);
+	g_array_remove_index(sm->rows, row);
+	sidebar_model_invalidate(sm);
+	gtk_tree_model_row_deleted(model, path);
+	gtk_tree_path_free(path);
+	if (sm->rows->len == 0)
+	{
+		sidebar_model_iter_top(sm, &top);
+		path = gtk_tree_path_new_first();
+		gtk_tree_model_row_has_child_toggled(model, path, &top);
+		gtk_tree_path_free(path);
+	}
+}
+
+/* Swaps two repositories' (or separators') rows. */
+static void tree_model_swap(GtkTreeModel *model, GtkTreeIter *a, GtkTreeIter *b)
+{
+	SidebarModel		*sm = SIDEBAR_MODEL(model);
+	const guint		ra = SIDEBAR_ITER_ROW(a) - 1, rb = SIDEBAR_ITER_ROW(b) - 1;
+	const SidebarRow	tmp = g_array_index(sm->rows, SidebarRow, ra);
+	gint			*order = g_new(gint, sm->rows->len);
+	GtkTreePath		*path = gtk_tree_path_new_first();
+	GtkTreeIter		top;
+
+	g_array_index(sm->rows, SidebarRow, ra) = g_array_index(sm->rows, SidebarRow, rb);
+	g_array_index(sm->rows, SidebarRow, rb) = tmp;
+	for (guint i = 0; i < sm->rows->len; i++)
+		order[i] = i == ra ? rb : i == rb ? ra : i;
+	sidebar_model_invalidate(sm);
+	sidebar_model_iter_top(sm, &top);
+	gtk_tree_model_rows_reordered(model, path, &top, order);
+	gtk_tree_path_free(path);
+	g_free(order);
+}
+
+/* Replaces the file table and tree of a repository with <files> and <tree>, which get the old ones back. The rows below the
+ * repository's are taken out (as far as the view is concerned) before, and put back after.
+*/
+static void tree_model_set_files(GtkTreeModel *model, GtkTreeIter *iter, FileTable *files, FileTree *tree)
+{
+	Repository	*repo = iter->user_data;
+	const FileTable	new_files = *files;
+	const FileTree	new_tree = *tree;
+	GtkTreePath	*path = gtk_tree_model_get_path(model, iter);
+	GtkTreeIter	child;
+	gint		count = gtk_tree_model_iter_n_children(model, iter);
+
+	*files = repo->files;
+	*tree = repo->tree;
+	memset(&repo->tree, 0, sizeof repo->tree);
+	gtk_tree_path_down(path);
+	for (gint i = 0; i < count; i++)
+		gtk_tree_model_row_deleted(model, path);
+	gtk_tree_path_up(path);
+	if (count > 0)
+		gtk_tree_model_row_has_child_toggled(model, path, iter);
+
+	repo->files = new_files;
+	repo->tree = new_tree;
+	/* The repository's own row is where it was, so its iterator can stay in use. */
+	sidebar_model_invalidate(SIDEBAR_MODEL(model));
+	iter->stamp = SIDEBAR_MODEL(model)->stamp;
+	if (gtk_tree_model_iter_children(model, &child, iter))
+	{
+		gtk_tree_path_down(path);
+		do
+		{
+			gtk_tree_model_row_inserted(model, path, &child);
+			if (gtk_tree_model_iter_has_child(model, &child))
+				gtk_tree_model_row_has_child_toggled(model, path, &child);
+			gtk_tree_path_next(path);
+		} while (gtk_tree_model_iter_next(model, &child));
+		gtk_tree_path_up(path);
+		gtk_tree_model_row_has_child_toggled(model, path, iter);
+	}
+	gtk_tree_path_free(path);
+}
+
+/* Brings the children of <dir> in the repository's tree in line with those of <new_dir> in <tree>, whose components are in
+ * <buffer>. The two lists are in the same order, so they're merged: rows only in the new tree are copied in, rows only in
+ * the old are unlinked, and the view is told of each; rows in both are left as they are, expanded or not, and directories
+ * in both are gone through the same way. All insertions are done before any removal, so a directory whose files are all
+ * replaced never looks empty to the view, which would collapse it. <path> is the row of <iter>, and is given back as it
+ * was. The nodes to unlink are kept on the <gone> stack meanwhile.
+*/
+static void tree_model_merge(GtkTreeModel *model, GtkTreeIter *iter, const FileTree *tree, const gchar *buffer, guint32 new_dir, GtkTreePath *path, GArray *gone)
+{
+	const SidebarModel	*sm = SIDEBAR_MODEL(model);
+	Repository		*repo = iter->user_data;
+	const guint32		dir = SIDEBAR_ITER_NODE(iter);
+	const guint		mark = gone->len;
+	const gboolean		had_children = repo->tree.nodes[dir].first_child != 0;
+	guint32			live = repo->tree.nodes[dir].first_child, node = tree->nodes[new_dir].first_child, prev = 0;
+	GtkTreeIter		child;
+
+	gtk_tree_path_down(path);
+	while (live != 0 || node != 0)
+	{
+		const gint	cmp = live == 0 ? 1 : node == 0 ? -1 : file_node_compare(&repo->tree, repo->files.buffer, live, tree, buffer, node);
+
+		if (cmp > 0)
+		{
+			/* New, so it goes in before the current row. The copy can move the nodes, so look them up after. */
+			const guint32	graft = file_tree_graft(&repo->tree, &repo->files, dir, tree, buffer, node);
+			FileNode	*nodes = repo->tree.nodes;
+
+			nodes[graft].next_sibling = live;
+			if (prev == 0)
+				nodes[dir].first_child = graft;
+			else
+				nodes[prev].next_sibling = graft;
+			sidebar_model_iter_node(sm, &child, repo, graft);
+			gtk_tree_model_row_inserted(model, path, &child);
+			if (nodes[graft].first_child != 0)
+				gtk_tree_model_row_has_child_toggled(model, path, &child);
+			prev = graft;
+			node = tree->nodes[node].next_sibling;
+		}
+		else
+		{
+			if (cmp < 0)
+				g_array_append_val(gone, live);
+			else
+			{
+				if (tree->nodes[node].first_child != 0)
+				{
+					sidebar_model_iter_node(sm, &child, repo, live);
+					tree_model_merge(model, &child, tree, buffer, node, path, gone);
+				}
+				node = tree->nodes[node].next_sibling;
+			}
+			prev = live;
+			live = repo->tree.nodes[live].next_sibling;
+		}
+		gtk_tree_path_next(path);
+	}
+	gtk_tree_path_up(path);
+	if (!had_children && repo->tree.nodes[dir].first_child != 0)
+		gtk_tree_model_row_has_child_toggled(model, path, iter);
+
+	/* The rows to remove are stacked in the order they're linked, so one more pass over the children finds them all. */
+	if (gone->len > mark)
+	{
+		FileNode	*nodes = repo->tree.nodes;
+		guint		next_gone = mark;
+
+		gtk_tree_path_down(path);
+		prev = 0;
+		for (guint32 here = nodes[dir].first_child, next; here != 0 && next_gone < gone->len; here = next)
+		{
+			next = nodes[here].next_sibling;
+			if (here == g_array_index(gone, guint32, next_gone))
+			{
+				if (prev == 0)
+					nodes[dir].first_child = next;
+				else
+					nodes[prev].next_sibling = next;
+				gtk_tree_model_row_deleted(model, path);
+				next_gone++;
+			}
+			else
+			{
+				prev = here;
+				gtk_tree_path_next(path);
+			}
+		}
+		gtk_tree_path_up(path);
+		g_array_set_size(gone, mark);
+		if (nodes[dir].first_child == 0)
+			gtk_tree_model_row_has_child_toggled(model, path, iter);
+	}
+}
+
+/* Like tree_model_set_files(), but for a repository that's already shown: only the rows that differ are inserted or removed,
+ * so the rest stay as they were, expanded or not. The shown tree is made over to look like the new one, after which the
+ * two can be swapped without the view noticing.
+*/
+static void tree_model_update_files(GtkTreeModel *model, GtkTreeIter *iter, FileTable *files, FileTree *tree)
+{
+	Repository	*repo = iter->user_data;
+	GtkTreePath	*path = gtk_tree_model_get_path(model, iter);
+	GArray		*gone = g_array_new(FALSE, FALSE, sizeof (guint32));
+	const FileTable	new_files = *files;
+	const FileTree	new_tree = *tree;
+
+	/* Copied nodes go at the end and removed ones stay where they are, so rows are found by following links meanwhile. */
+	repo->tree.contiguous = FALSE;
+	tree_model_merge(model, iter, tree, files->buffer, 0, path, gone);
+	g_array_free(gone, TRUE);
+	gtk_tree_path_free(path);
+
+	*files = repo->files;
+	*tree = repo->tree;
+	repo->files = new_files;
+	repo->tree = new_tree;
+	/* The rows are the same, but their nodes aren't. */
+	sidebar_model_invalidate(SIDEBAR_MODEL(model));
+	iter->stamp = SIDEBAR_MODEL(model)->stamp;
+}
+
+/* Look up a repository, by searching for a node immediately under the root that has the given path as its data. */
+gboolean tree_model_find_repository(GtkTreeModel *model, const gchar *root_path, GtkTreeIter *iter)
+{
+	GtkTreeIter	root;
+	gboolean	found = FALSE;
+
+	if (gtk_tree_model_get_iter_first(model, &root))
+	{
+		if (gtk_tree_model_iter_children(model, iter, &root))
+		{
+			const gchar	*data;
+
+			do
+			{
+				gtk_tree_model_get(model, iter, 1, &data, -1);
+				if (data != NULL)
+					found = strcmp(data, root_path) == 0;
+			} while (gtk_tree_model_iter_next(model, iter));
+		}
+	}
+	return found;
+}
+
+
+/* Finds the directory git keeps a repository's state in. That's the ".git" in its root, unless that's a file with a "gitdir:"
+ * line pointing somewhere else, as it is for worktrees and submodules; a relative path there is relative to the root. Fine to
+ * call from any thread.
+*/
+static gchar * get_git_dir(const gchar *root_path)
+{
+	gchar	*dot_git = g_build_filename(root_path, ".git", NULL), *text;
+
+	if (g_file_test(dot_git, G_FILE_TEST_IS_REGULAR) && g_file_get_contents(dot_git, &text, NULL, NULL))
+	{
+		if (strncmp(text, "gitdir:", 7) == 0)
+		{
+			const gchar	*dir = g_strstrip(text + 7);
+
+			g_free(dot_git);
+			dot_git = g_path_is_absolute(dir) ? g_strdup(dir) : g_build_filename(root_path, dir, NULL);
+		}
+		g_free(text);
+	}
+	return dot_git;
+}
+
+/* Reads HEAD in <git_dir> to figure out which branch the repository is on. A detached HEAD gives the commit instead, as
+ * abbreviated as git usually does. Fine to call from any thread.
+*/
+static gboolean get_branch(gchar *branch, gsize branch_max, const gchar *git_dir)
+{
+	gchar		*fn = g_build_filename(git_dir, "HEAD", NULL), *head;
+	gboolean	ret = FALSE;
+
+	if (g_file_get_contents(fn, &head, NULL, NULL))
+	{
+		const gchar	*ptr = g_strstrip(head);
+
+		if (strncmp(ptr, "ref:", 4) == 0)
+		{
+			for (ptr += 4; isspace((unsigned int) *ptr); ptr++)
+				;
+			if (strncmp(ptr, "refs/heads/", 11) == 0)
+				ptr += 11;
+			else if (strncmp(ptr, "refs/", 5) == 0)
+				ptr += 5;
+			ret = *ptr != '\0' && g_snprintf(branch, branch_max, "%s", ptr) < branch_max;
+		}
+		else if (strspn(ptr, "0123456789abcdef") >= 2 * GITINDEX_OID_SIZE)
+			ret = g_snprintf(branch, branch_max, "%.7s", ptr) < branch_max;
+		g_free(head);
+	}
+	g_free(fn);
+	return ret;
+}
+
+/* Repositories are watched for changes to their index and HEAD, which is what adding or removing files, committing and
+ * switching branches all do. Git writes them by renaming new files over the old, and a rebase does that for each commit,
+ * so the events are left to settle before the repository is refreshed, once. Both files are in the same directory, which
+ * is all inotify watches, so that's one watch per repository, and nothing at all happens while they're left alone.
+*/
+static gboolean cb_repository_watch_quiet(gpointer user)
+{
+	Repository	*repo = user;
+	SidebarModel	*sm = SIDEBAR_MODEL(gitbrowser.model);
+	const guint	row = sidebar_model_find_row(sm, repo);
+
+	repo->watch_quiet = 0;
+	if (row < sm->rows->len)
+	{
+		GtkTreeIter	iter;
+
+		sidebar_model_iter_row(sm, &iter, row);
+		tree_model_build_repository(gitbrowser.model, &iter, repo);
+	}
+	return FALSE;
+}
+
+static void cb_repository_watch_changed(GFileMonitor *monitor, GFile *file, GFile *other, GFileMonitorEvent event, gpointer user)
+{
+	Repository	*repo = user;
 
-	tmr = g_timer_new();
-	for (guint i = 0; valid && g_timer_elapsed(tmr, NULL) < max_time; i++)
-	{
-		gchar		*name, *name_lower, path[16];
-		gboolean	old_visible, new_visible;
+	if (repo->watch_quiet != 0)
+		g_source_remove(repo->watch_quiet);
+	repo->watch_quiet = g_timeout_add(WATCH_QUIET_TIME, cb_repository_watch_quiet, repo);
+}
 
-		g_snprintf(path, sizeof path, "%u", qoi->filter_row);
-		valid = gtk_tree_model_get_iter_from_string(GTK_TREE_MODEL(qoi->store), &iter, path);
-		if (!valid)
-			break;
-		gtk_tree_model_get(GTK_TREE_MODEL(qoi->store), &iter, QO_NAME, &name, QO_NAME_LOWER, &name_lower, QO_VISIBLE, &old_visible, -1);
-		new_visible = strstr(name_lower, qoi->filter_lower) != NULL;
-		if (new_visible != old_visible)
-			gtk_list_store_set(qoi->store, &iter, QO_VISIBLE, new_visible, -1);
-		if (!new_visible)
-			qoi->files_filtered++;
-		else
+static void repository_watch_stop(Repository *repo)
+{
+	for (gsize i = 0; i < G_N_ELEMENTS(repo->watch); i++)
+	{
+		if (repo->watch[i] != NULL)
 		{
-			const gint16 dist = levenshtein_compute_half(&qoi->filter_ld, name);
-			gtk_list_store_set(qoi->store, &iter, QO_DISTANCE, dist, -1);
-			printf("updated distance to '%s' to %d\n", name, dist);
+			g_signal_handlers_disconnect_by_data(repo->watch[i], repo);
+			g_file_monitor_cancel(repo->watch[i]);
+			g_object_unref(repo->watch[i]);
+			repo->watch[i] = NULL;
 		}
-		++qoi->filter_row;
 	}
-	g_timer_destroy(tmr);
-	open_quick_update_label(qoi);
-	if (!valid)
+	if (repo->watch_quiet != 0)
 	{
-		/* Done! */
-		first = gtk_tree_path_new_first();
-		gtk_tree_view_set_cursor(GTK_TREE_VIEW(qoi->view), first, NULL, FALSE);
-		gtk_tree_path_free(first);
-		qoi->filter_idle = 0;
-		levenshtein_end(&qoi->filter_ld);
-		gtk_spinner_stop(GTK_SPINNER(qoi->spinner));
-		gtk_widget_hide(qoi->spinner);
-		return FALSE;
+		g_source_remove(repo->watch_quiet);
+		repo->watch_quiet = 0;
 	}
-	return TRUE;
 }
 
-static void evt_open_quick_entry_changed(GtkWidget *wid, gpointer user)
+/* Starts watching the repository, or watches it in a new place if its git directory has moved. */
+static void repository_watch(Repository *repo, const gchar *git_dir)
 {
-	QuickOpenInfo	*qoi = user;
-	const gchar	*filter = gtk_entry_buffer_get_text(gtk_entry_get_buffer(GTK_ENTRY(wid)));
-	gchar		*filter_lower;
+	static const gchar * const	names[] = { "index", "HEAD" };
 
-	/* Extract search string, convert to lower-case for filtering. */
-	g_strlcpy(qoi->filter_text, filter, sizeof qoi->filter_text);
-	filter_lower = g_utf8_strdown(filter, -1);
-	g_strlcpy(qoi->filter_lower, filter_lower, sizeof qoi->filter_lower);
-	g_free(filter_lower);
+	if (repo->watch[0] != NULL && repo->git_dir != NULL && strcmp(repo->git_dir, git_dir) == 0)
+		return;
+	repository_watch_stop(repo);
+	for (gsize i = 0; i < G_N_ELEMENTS(names); i++)
+	{
+		gchar	*fn = g_build_filename(git_dir, names[i], NULL);
+		GFile	*file = g_file_new_for_path(fn);
 
-	printf("set Levenshtein reference to '%s'\n", qoi->filter_text);
-	levenshtein_begin_half(&qoi->filter_ld, qoi->filter_text);
-	qoi->files_filtered = 0;
-	gtk_spinner_start(GTK_SPINNER(qoi->spinner));
-	gtk_widget_show(qoi->spinner);
+		if ((repo->watch[i] = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL)) != NULL)
+			g_signal_connect(repo->watch[i], "changed", G_CALLBACK(cb_repository_watch_changed), repo);
+		g_object_unref(file);
+		g_free(fn);
+	}
+}
 
-	gtk_entry_set_icon_sensitive(GTK_ENTRY(wid), GTK_ENTRY_ICON_SECONDARY, qoi->filter_text[0] != '\0');
+/* Lists a repository's files in the background. The branch is found and the index read by a worker in the list pool, or
+ * if the index can't be read, 'git ls-files' is run. Either way, the paths go into a new file table, and a tree of their
+ * components, as they're found; once they're all in, the sidebar is re-built from the tree and the table replaces the old.
+*/
+struct ListBuild
+{
+	Repository		*repo;			/* NULL once cancelled, while the build is still in the pool. */
+	GtkTreeModel		*model;
+	GtkTreeRowReference	*row;			/* The repository's row in the sidebar. */
+	gchar			*root_path;		/* Copies for the worker, which can't look at the repository. */
+	gchar			*git_dir;		/* Found by the worker, along with the rest below. */
+	guint			priority;		/* 0 for the current document's repository, which is listed first. */
+	guint			sequence;		/* Order of queueing, which is kept otherwise. */
+	gboolean		pooled;			/* In the pool; the worker has the build until it's handed back. */
+	gboolean		indexed;		/* If the index was read, by the worker. */
+	gboolean		unchanged;		/* Or if it didn't need to be, since it lists the same files as last time. */
+	guint8			checksum[GITINDEX_OID_SIZE];	/* The repository's, when the build started ... */
+	gboolean		checksum_valid;			/* ... if it has one at all ... */
+	guint64			digest;				/* ... and the digest of its entries, which goes with it. */
+	gchar			branch[256];		/* Also found by the worker, empty if it couldn't be. */
+	SubprocessStream	*ls;
+	FileTable		files;
+	FileTree		tree;			/* Directory tree of 'files'. */
+	GTimer			*timer;
+};
 
-	qoi->filter_row = 0;
-	if (qoi->filter_idle == 0)
+static void list_build_free(ListBuild *build)
+{
+	gtk_tree_row_reference_free(build->row);
+	g_free(build->root_path);
+	g_free(build->git_dir);
+	file_table_clear(&build->files);
+	file_tree_clear(&build->tree);
+	g_timer_destroy(build->timer);
+	g_free(build);
+}
+
+/* Forgets the expansion loaded with the configuration once no repository is being listed: it's been applied to every
+ * repository that got listed by then, and from now on the view's own is saved. Called wherever a listing ends, however.
+*/
+static void repository_list_settle(void)
+{
+	GHashTableIter	iter;
+	gpointer	value;
+
+	if (gitbrowser.expanded == NULL)
+		return;
+	g_hash_table_iter_init(&iter, gitbrowser.repositories);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
 	{
-		qoi->filter_idle = g_idle_add(cb_open_quick_filter_idle, qoi);
+		if (((Repository *) value)->list_build != NULL)
+			return;
 	}
+	g_free(gitbrowser.expanded);
+	gitbrowser.expanded = NULL;
 }
 
-static void evt_open_quick_entry_icon_release(GtkWidget *wid, GtkEntryIconPosition position, GdkEvent *evt, gpointer user)
+/* Stops listing a repository's files, leaving it as it was. */
+static void repository_list_cancel(Repository *repo)
 {
-	gtk_entry_set_text(GTK_ENTRY(wid), "");	/* There's only one icon, so no need to figure out which was clicked. */
+	if (repo->list_build != NULL)
+	{
+		if (repo->list_build->pooled)
+		{
+			repo->list_build->repo = NULL;
+			gitbrowser.list_cancelled = g_slist_prepend(gitbrowser.list_cancelled, repo->list_build);
+		}
+		else
+		{
+			subprocess_stream_cancel(repo->list_build->ls);
+			list_build_free(repo->list_build);
+		}
+		repo->list_build = NULL;
+	}
 }
 
-static gboolean evt_open_quick_entry_key_press(GtkWidget *wid, GdkEventKey *evt, gpointer user)
+/* Expands the rows in <paths> (as from tree_view_get_expanded()) that are at or below <below>, leaving all other rows alone. */
+static void tree_view_set_expanded_below(GtkTreeView *view, const gchar *paths, GtkTreePath *below)
 {
-	QuickOpenInfo	*qoi = user;
+	gchar	**tokens = g_strsplit(paths, ",", -1);
 
-	if (evt->type == GDK_KEY_PRESS)
+	for (gsize i = 0; tokens[i] != NULL; i++)
 	{
-		/* This is, unfortunately, something of a hack: to make cursor up/down keys
-		 * in the entry affect the selection in the tree view, we copy the event,
-		 * poke the window member, and re-emit it. The best thing is that it works.
-		 *
-		 * FIXME: There should be a better way of implementing this. Find it.
-		*/
-		if (evt->keyval == GDK_KEY_Up || evt->keyval == GDK_KEY_Down ||
-		   evt->keyval == GDK_KEY_Page_Up || evt->keyval == GDK_KEY_Page_Down)
-		{
-			GdkEventKey	copy = *evt;
-
-			copy.window = gtk_widget_get_window(qoi->view);
-			copy.send_event = TRUE;
-			gtk_widget_grab_focus(qoi->view);
-			gtk_main_do_event((GdkEvent *) &copy);
-			gtk_widget_grab_focus(wid);
+		GtkTreePath	*path;
 
-			return TRUE;
+		if ((path = gtk_tree_path_new_from_string(tokens[i])) != NULL)
+		{
+			if (gtk_tree_path_compare(path, below) == 0 || gtk_tree_path_is_descendant(path, below))
+				gtk_tree_view_expand_row(view, path, FALSE);
+			gtk_tree_path_free(path);
 		}
 	}
-	return FALSE;
+	g_strfreev(tokens);
 }
 
-static void cdf_open_quick_filename(GtkTreeViewColumn *tree_column, GtkCellRenderer *cell, GtkTreeModel *model, GtkTreeIter *iter, gpointer user)
+static void cb_repository_list_records(gchar *data, gsize len, gpointer user)
 {
-	gchar	*filename;
+	ListBuild	*build = user;
+	const guint32	first = build->files.num_files;
 
-	gtk_tree_model_get(model, iter, QO_NAME, &filename, -1);
-	g_object_set(G_OBJECT(cell), "text", filename, NULL);
+	file_table_append(&build->files, data, len, '\0');
+	file_tree_add(&build->tree, &build->files, first);
 }
 
-static void cdf_open_quick_location(GtkTreeViewColumn *tree_column, GtkCellRenderer *cell, GtkTreeModel *model, GtkTreeIter *iter, gpointer user)
+static void cb_repository_list_done(gboolean success, gpointer user);
+
+/* Adds an index entry to a running digest of the parts that make a difference to the listing: its path, mode and stage.
+ * The rest is mostly stat data, which git rewrites all the time (every 'git status' does), with the same files listed.
+ * This is FNV-1a, over 64 bits so two different listings are very unlikely to come out the same.
+*/
+static guint64 list_build_digest(guint64 digest, const GitIndexEntry *entry)
 {
-	gchar	*location;
+	const guint32	extra[] = { entry->mode, entry->stage };
+	const guchar	*bytes = (const guchar *) extra;
 
-	gtk_tree_model_get(model, iter, QO_PATH, &location, -1);
-	g_object_set(G_OBJECT(cell), "text", location, NULL);
+	for (gsize i = 0; i <= entry->path_len; i++)
+	{
+		digest ^= (guchar) entry->path[i];
+		digest *= G_GUINT64_CONSTANT(1099511628211);
+	}
+	for (gsize i = 0; i < sizeof extra; i++)
+	{
+		digest ^= bytes[i];
+		digest *= G_GUINT64_CONSTANT(1099511628211);
+	}
+	return digest;
 }
 
-static gint cb_open_quick_sort(GtkTreeModel *model, GtkTreeIter *a, GtkTreeIter *b, gpointer user)
+/* Only digests the index, to see if it lists anything new before reading it for real. */
+static void cb_repository_list_digest(const GitIndexEntry *entry, gpointer user)
 {
-	guint		da, db;
-	const gchar	*na, *nb;
+	guint64	*digest = user;
 
-	gtk_tree_model_get(model, a, QO_DISTANCE, &da, -1);
-	gtk_tree_model_get(model, b, QO_DISTANCE, &db, -1);
-
-	if (da < db)
-		return -1;
-	if (da > db)
-		return 1;
+	*digest = list_build_digest(*digest, entry);
+}
 
-	gtk_tree_model_get(model, a, QO_NAME_LOWER, &na, -1);
-	gtk_tree_model_get(model, b, QO_NAME_LOWER, &nb, -1);
-	const gint ret = g_utf8_collate(na, nb);
-	/* Note: QO_NAME_LOWER is G_TYPE_POINTER, not string so: no g_free()! */
+/* Index entries come in the same order as 'git ls-files' lists them, so they're added the same way. The only difference
+ * is that a conflicted path has an entry per side, and is only added once.
+*/
+static void cb_repository_list_entry(const GitIndexEntry *entry, gpointer user)
+{
+	ListBuild	*build = user;
+	const guint32	first = build->files.num_files;
 
-	return ret;
+	build->files.digest = list_build_digest(build->files.digest, entry);
+	if (entry->stage > 1 && first > 0 && strcmp(file_table_get(&build->files, first - 1), entry->path) == 0)
+		return;
+	file_table_append(&build->files, entry->path, entry->path_len + 1, '\0');
+	file_tree_add(&build->tree, &build->files, first);
 }
 
-void repository_open_quick(Repository *repo)
-{
-	QuickOpenInfo	*qoi;
+static gboolean cb_repository_list_pooled(gpointer user);
 
-	if (repo == NULL)
+/* Runs in the list pool. Nothing here touches the repository, or anything else the main thread might. */
+static void list_build_run(gpointer data, gpointer user)
+{
+	ListBuild	*build = data;
+	gchar		*index;
+	guint8		checksum[GITINDEX_OID_SIZE];
+	gboolean	has_checksum;
+	guint64		digest = LIST_DIGEST_INITIAL;
+
+	build->git_dir = get_git_dir(build->root_path);
+	if (!get_branch(build->branch, sizeof build->branch, build->git_dir))
+		build->branch[0] = '\0';
+	index = g_build_filename(build->git_dir, "index", NULL);
+	/* The checksum is taken first, so if the index changes while it's read, that's seen next time. If it has changed, it's
+	 * usually just the stat data, so the entries are digested to see if they're worth reading.
+	*/
+	has_checksum = gitindex_checksum(index, checksum);
+	if (has_checksum && build->checksum_valid)
 	{
-		msgwin_status_add(_("Current document is not part of a known repository. Use Add to add a repository."));
-		return;
+		if (memcmp(checksum, build->checksum, sizeof checksum) == 0)
+			build->unchanged = TRUE;
+		else if (gitindex_read(index, cb_repository_list_digest, &digest) && digest == build->digest)
+			build->unchanged = TRUE;
 	}
-	qoi = &repo->quick_open;
-
-	if (qoi->dialog == NULL)
+	if (!build->unchanged)
 	{
-		GtkWidget		*vbox, *label, *scwin, *title, *hbox;
-		GtkCellRenderer         *cr;
-		GtkTreeViewColumn       *vc;
-		gchar			tbuf[64], *name;
-
-		qoi->store = gtk_list_store_new(QO_NUM_COLUMNS, G_TYPE_POINTER, G_TYPE_POINTER, G_TYPE_POINTER, G_TYPE_BOOLEAN, G_TYPE_UINT);
-		qoi->names = g_string_sized_new(32 << 10);
-		repository_to_list(repo, gitbrowser.model, qoi);
-
-		if ((name = strrchr(repo->root_path, G_DIR_SEPARATOR)) != NULL)
-			name++;
-		else
-			name = repo->root_path;
-		g_snprintf(tbuf, sizeof tbuf, _("Quick Open in Git Repository \"%s\""), name);
-
-		qoi->dialog = gtk_dialog_new_with_buttons(tbuf, NULL, GTK_DIALOG_MODAL, "_OK", GTK_RESPONSE_OK, "_Cancel", GTK_RESPONSE_CANCEL, NULL);
-		gtk_dialog_set_default_response(GTK_DIALOG(qoi->dialog), GTK_RESPONSE_OK);
-		gtk_window_set_default_size(GTK_WINDOW(qoi->dialog), 600, 600);
-
-		vbox = ui_dialog_vbox_new(GTK_DIALOG(qoi->dialog));
-		label = gtk_label_new(_("Select one or more document(s) to open. Type to filter filenames."));
-		gtk_box_pack_start(GTK_BOX(vbox), label, FALSE, FALSE, 0);
-		/* Create a label showing filtering status. */
-		hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
-		qoi->spinner = gtk_spinner_new();
-		gtk_box_pack_start(GTK_BOX(hbox), qoi->spinner, FALSE, FALSE, 0);
-		qoi->label = gtk_label_new("");
-		gtk_box_pack_start(GTK_BOX(hbox), qoi->label, TRUE, TRUE, 0);
-		open_quick_update_label(qoi);
-		gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
-		gtk_widget_show_all(hbox);
-		gtk_widget_hide(qoi->spinner);
-		qoi->filter = gtk_tree_model_filter_new(GTK_TREE_MODEL(qoi->store), NULL);
-		gtk_tree_model_filter_set_visible_column(GTK_TREE_MODEL_FILTER(qoi->filter), QO_VISIBLE);	/* Filter on the boolean column. */
-		qoi->sort = gtk_tree_model_sort_new_with_model(qoi->filter);
-		gtk_tree_sortable_set_default_sort_func(GTK_TREE_SORTABLE(qoi->sort), cb_open_quick_sort, qoi, NULL);
-		qoi->view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(qoi->sort));
-
-		vc = gtk_tree_view_column_new();
-		cr = gtk_cell_renderer_text_new();
-		title = gtk_label_new(_("Filename"));
-		gtk_widget_show(title);
-		gtk_tree_view_column_set_widget(vc, title);
-		gtk_tree_view_append_column(GTK_TREE_VIEW(qoi->view), vc);
-		gtk_tree_view_column_pack_start(vc, cr, TRUE);
-		gtk_tree_view_column_set_cell_data_func(vc, cr, cdf_open_quick_filename, qoi, NULL);
-
-		vc = gtk_tree_view_column_new();
-		cr = gtk_cell_renderer_text_new();
-		title = gtk_label_new(_("Location"));
-		gtk_widget_show(title);
-		gtk_tree_view_column_set_widget(vc, title);
-		gtk_tree_view_append_column(GTK_TREE_VIEW(qoi->view), vc);
-		gtk_tree_view_column_pack_start(vc, cr, TRUE);
-		gtk_tree_view_column_set_cell_data_func(vc, cr, cdf_open_quick_location, qoi, NULL);
-		gtk_tree_view_set_headers_clickable(GTK_TREE_VIEW(qoi->view), FALSE);
-
-		scwin = gtk_scrolled_window_new(NULL, NULL);
-		gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(scwin), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
-		g_signal_connect(G_OBJECT(qoi->view), "row_activated", G_CALLBACK(evt_open_quick_view_row_activated), qoi);
-		gtk_container_add(GTK_CONTAINER(scwin), qoi->view);
-		gtk_box_pack_start(GTK_BOX(vbox), scwin, TRUE, TRUE, 0);
-		qoi->entry = gtk_entry_new();
-		gtk_entry_set_activates_default(GTK_ENTRY(qoi->entry), TRUE);
-		gtk_entry_set_icon_from_icon_name(GTK_ENTRY(qoi->entry), GTK_ENTRY_ICON_SECONDARY, "edit-clear");
-		gtk_entry_set_icon_sensitive(GTK_ENTRY(qoi->entry), GTK_ENTRY_ICON_SECONDARY, FALSE);
-		g_signal_connect(G_OBJECT(qoi->entry), "changed", G_CALLBACK(evt_open_quick_entry_changed), qoi);
-		g_signal_connect(G_OBJECT(qoi->entry), "key-press-event", G_CALLBACK(evt_open_quick_entry_key_press), qoi);
-		g_signal_connect(G_OBJECT(qoi->entry), "icon-release", G_CALLBACK(evt_open_quick_entry_icon_release), qoi);
-		gtk_box_pack_start(GTK_BOX(vbox), qoi->entry, FALSE, FALSE, 0);
-
-		gtk_dialog_set_response_sensitive(GTK_DIALOG(qoi->dialog), GTK_RESPONSE_OK, FALSE);
-
-		gtk_widget_show_all(vbox);
-
-		qoi->selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(qoi->view));
-		gtk_tree_selection_set_mode(qoi->selection, GTK_SELECTION_MULTIPLE);
-		g_signal_connect(G_OBJECT(qoi->selection), "changed", G_CALLBACK(evt_open_quick_selection_changed), qoi);
+		build->files.digest = LIST_DIGEST_INITIAL;
+		build->indexed = gitindex_read(index, cb_repository_list_entry, build);
 	}
-	gtk_editable_select_region(GTK_EDITABLE(qoi->entry), 0, -1);
-	gtk_widget_grab_focus(qoi->entry);
-	if (gtk_dialog_run(GTK_DIALOG(qoi->dialog)) == GTK_RESPONSE_OK)
+	if ((build->unchanged || build->indexed) && has_checksum)
 	{
-		GList	*selection = gtk_tree_selection_get_selected_rows(qoi->selection, NULL), *iter;
-
-		for (iter = selection; iter != NULL; iter = g_list_next(iter))
-		{
-			GtkTreePath	*path_filter;
-
-			if ((path_filter = gtk_tree_model_sort_convert_path_to_child_path(GTK_TREE_MODEL_SORT(qoi->sort), iter->data)) != NULL)
-			{
-				GtkTreePath	*path_root;
-
-				if ((path_root = gtk_tree_model_filter_convert_path_to_child_path(GTK_TREE_MODEL_FILTER(qoi->filter), path_filter)) != NULL)
-				{
-					GtkTreeIter	here;
-
-					if (gtk_tree_model_get_iter(GTK_TREE_MODEL(qoi->store), &here, path_root))
-					{
-						gchar	buf[2048], *dpath, *dname, *fn;
-						gint	len;
-
-						gtk_tree_model_get(GTK_TREE_MODEL(qoi->store), &here, QO_NAME, &dname, QO_PATH, &dpath, -1);
-						if ((len = g_snprintf(buf, sizeof buf, "%s%s%s", dpath, G_DIR_SEPARATOR_S, dname)) < sizeof buf)
-						{
-							if ((fn = g_filename_from_utf8(buf, (gssize) len, NULL, NULL, NULL)) != NULL)
-							{
-								document_open_file(buf, FALSE, NULL, NULL);
-								g_free(fn);
-							}
-						}
-					}
-					gtk_tree_path_free(path_root);
-				}
-				gtk_tree_path_free(path_filter);
-			}
-		}
-		g_list_foreach(selection, (GFunc) gtk_tree_path_free, NULL);
-		g_list_free(selection);
+		memcpy(build->files.checksum, checksum, sizeof checksum);
+		build->files.checksum_valid = TRUE;
 	}
-	gtk_widget_hide(qoi->dialog);
+	g_free(index);
+	g_idle_add(cb_repository_list_pooled, build);
 }
 
-/* -------------------------------------------------------------------------------------------------------------- */
-
-GtkTreeModel * tree_model_new(void)
+/* The current document's repository goes first, then it's first come, first served. */
+static gint cb_list_build_compare(gconstpointer a, gconstpointer b, gpointer user)
 {
-	GtkTreeStore	*ts;
-	GtkTreeIter	iter;
+	const ListBuild	*ba = a, *bb = b;
 
-	/* First column is display text, second is corresponding path (or path part). All are NULL for separators. */
-	ts = gtk_tree_store_new(2, G_TYPE_STRING, G_TYPE_STRING);
-	gtk_tree_store_append(ts, &iter, NULL);
-	gtk_tree_store_set(ts, &iter, 0, _("Repositories (Right-click to add)"), 1, NULL, -1);
-
-	return GTK_TREE_MODEL(ts);
+	if (ba->priority != bb->priority)
+		return ba->priority < bb->priority ? -1 : 1;
+	return ba->sequence < bb->sequence ? -1 : ba->sequence > bb->sequence;
 }
 
-/* Look up a repository, by searching for a node immediately under the root that has the given path as its data. */
-gboolean tree_model_find_repository(GtkTreeModel *model, const gchar *root_path, GtkTreeIter *iter)
+/* Returns the list pool, creating it if needed. Listing is mostly waiting for the disk (and for git, when it's run), so
+ * a few threads are enough to keep it busy, without a few dozen repositories swamping the machine at startup.
+*/
+static GThreadPool * repository_list_pool(void)
 {
-	GtkTreeIter	root;
-	gboolean	found = FALSE;
-
-	if (gtk_tree_model_get_iter_first(model, &root))
+	if (gitbrowser.list_pool == NULL)
 	{
-		if (gtk_tree_model_iter_children(model, iter, &root))
-		{
-			gchar	*data;
-
-			do
-			{
-				gtk_tree_model_get(model, iter, 1, &data, -1);
-				if (data != NULL)
-				{
-					found = strcmp(data, root_path) == 0;
-					g_free(data);
-				}
-			} while (gtk_tree_model_iter_next(model, iter));
-		}
+		gitbrowser.list_pool = g_thread_pool_new(list_build_run, NULL, LIST_POOL_THREADS, FALSE, NULL);
+		g_thread_pool_set_sort_function(gitbrowser.list_pool, cb_list_build_compare, NULL);
 	}
-	return found;
+	return gitbrowser.list_pool;
 }
 
-static guint	tree_model_build_populate(GtkTreeModel *model, gchar *lines, GtkTreeIter *parent);
-static guint	tree_model_build_traverse(GtkTreeModel *model, GNode *root, GtkTreeIter *parent);
+/* Holds off the list pool while several repositories are queued, so they're started in priority order. */
+static void repository_list_hold(gboolean hold)
+{
+	g_thread_pool_set_max_threads(repository_list_pool(), hold ? 0 : LIST_POOL_THREADS, NULL);
+}
 
-/* Run "git branch" to figure out which branch <root_path> is on. */
-static gboolean get_branch(gchar *branch, gsize branch_max, const gchar *root_path)
+/* Geany's done starting up, and has opened the session's documents, so the current one's repository can go first after all:
+ * the builds queued before then didn't know which it was. The pool sorts builds as they're pushed, so setting the sort
+ * function again sorts the queue over.
+*/
+static void cb_repository_list_startup(GObject *object, gpointer user)
 {
-	gchar		*git_branch[] = { "git", "branch", "--no-color", NULL }, *git_stdout = NULL, *git_stderr = NULL;
-	gboolean	ret = FALSE;
+	const GeanyDocument	*doc = document_get_current();
+	const Repository	*current = doc != NULL ? repository_find_by_path(doc->real_path) : NULL;
+	GHashTableIter		iter;
+	gpointer		value;
 
-	if (subprocess_run(root_path, git_branch, NULL, &git_stdout, &git_stderr))
+	g_hash_table_iter_init(&iter, gitbrowser.repositories);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
 	{
-		gchar	*lines = git_stdout, *line, *nextline;
+		const Repository	*repo = value;
 
-		while ((line = tok_tokenize_next(lines, &nextline, '\n')) != NULL)
-		{
-			if (line[0] == '*')
-			{
-				const gchar	*ptr = line + 1;
+		if (repo->list_build != NULL && repo->list_build->pooled)
+			repo->list_build->priority = repo == current ? 0 : 1;
+	}
+	g_thread_pool_set_sort_function(repository_list_pool(), cb_list_build_compare, NULL);
+	repository_list_hold(FALSE);
+}
 
-				while (isspace((unsigned int) *ptr))
-					ptr++;
+/* Starts 'git ls-files', for when the index couldn't be read. */
+static void repository_list_spawn(ListBuild *build)
+{
+	const gchar * const	git_ls_files[] = { "git", "ls-files", "-z", NULL };
 
-				ret = g_snprintf(branch, branch_max, "%s", ptr) < branch_max;
-				break;
-			}
-			lines = nextline;
-		}
-		g_free(git_stdout);
-		g_free(git_stderr);
+	if ((build->ls = subprocess_stream_start(build->repo->root_path, git_ls_files, '\0', cb_repository_list_records, cb_repository_list_done, build)) == NULL)
+	{
+		build->repo->list_build = NULL;
+		list_build_free(build);
+		repository_list_settle();
 	}
-	return ret;
 }
 
-void tree_model_build_repository(GtkTreeModel *model, GtkTreeIter *repo, const gchar *root_path)
+/* Back from the pool: the repository's label gets its branch, and its tree is put in if the index was read (or left, if it
+ * hasn't changed).
+*/
+static gboolean cb_repository_list_pooled(gpointer user)
 {
-	GtkTreeIter	new;
-	const gchar	*slash;
-	gchar		*git_ls_files[] = { "git", "ls-files", NULL }, *git_stdout = NULL, *git_stderr = NULL;
-	gchar		branch[256];
-	GTimer		*timer;
-
-	slash = strrchr(root_path, G_DIR_SEPARATOR);
-	if (slash == NULL)
-		slash = root_path;
-	else
-		slash++;
+	ListBuild	*build = user;
+	GtkTreePath	*path;
 
-	if (repo == NULL)
+	build->pooled = FALSE;
+	if (build->repo == NULL)
 	{
-		GtkTreeIter	iter;
-
-		if (gtk_tree_model_get_iter_first(model, &iter))
-		{
-			repo = &new;
-			gtk_tree_store_append(GTK_TREE_STORE(model), repo, &iter);
-		}
+		gitbrowser.list_cancelled = g_slist_remove(gitbrowser.list_cancelled, build);
+		list_build_free(build);
+		return FALSE;
 	}
-	/* At this point, we have a root iter in the tree, which we need to populate. */
-	if (get_branch(branch, sizeof branch, root_path))
+	repository_watch(build->repo, build->git_dir);
+	g_free(build->repo->git_dir);
+	build->repo->git_dir = g_strdup(build->git_dir);
+	if ((path = gtk_tree_row_reference_get_path(build->row)) != NULL)
 	{
-		gchar	disp[1024];
+		GtkTreeIter	iter;
+		gchar		label[1024];
 
-		g_snprintf(disp, sizeof disp, "%s [%s]", slash, branch);
-		gtk_tree_store_set(GTK_TREE_STORE(model), repo,  0, disp,  1, root_path,  -1);
+		gtk_tree_model_get_iter(build->model, &iter, path);
+		tree_model_set_label(build->model, &iter, repository_get_label(build->repo, build->branch, label, sizeof label));
+		gtk_tree_path_free(path);
 	}
+	if (build->indexed || build->unchanged)
+		cb_repository_list_done(TRUE, build);
 	else
-		gtk_tree_store_set(GTK_TREE_STORE(model), repo,  0, slash,  1, root_path,  -1);
-
-	/* Now list the repository, and build a tree representation. Easy-peasy, right? */
-	timer = g_timer_new();
-	if (subprocess_run(root_path, git_ls_files, NULL, &git_stdout, &git_stderr))
 	{
-		GtkTreePath	*path;
-		const guint	counter = tree_model_build_populate(model, git_stdout, repo);
-
-		g_free(git_stdout);
-		g_free(git_stderr);
-
-		path = gtk_tree_model_get_path(model, repo);
-		gtk_tree_view_expand_to_path(GTK_TREE_VIEW(gitbrowser.view), path);
-		gtk_tree_view_set_cursor_on_cell(GTK_TREE_VIEW(gitbrowser.view), path, NULL, NULL, FALSE);
-		gtk_tree_path_free(path);
-		msgwin_status_add(_("Built repository \"%s\"; %lu files added in %.1f ms."), slash, (unsigned long) counter, 1e3 * g_timer_elapsed(timer, NULL));
+		/* A split index, or something else that's not understood. Whatever was read is thrown away. */
+		file_table_clear(&build->files);
+		file_tree_clear(&build->tree);
+		file_tree_init(&build->tree);
+		repository_list_spawn(build);
 	}
-	g_timer_destroy(timer);
+	return FALSE;
 }
 
-void tree_model_build_separator(GtkTreeModel *model)
+static void cb_repository_list_done(gboolean success, gpointer user)
 {
-	GtkTreeIter	root, sep;
-
-	if (gtk_tree_model_get_iter_first(model, &root))
+	ListBuild	*build = user;
+	Repository	*repo = build->repo;
+	GtkTreePath	*path;
+
+	repo->list_build = NULL;
+	/* Only the index's stat data changed, if anything; it'll be told by the new checksum from now on. */
+	if (success && build->unchanged && build->files.checksum_valid)
+		memcpy(repo->files.checksum, build->files.checksum, sizeof repo->files.checksum);
+	if (success && !build->unchanged && (path = gtk_tree_row_reference_get_path(build->row)) != NULL)
 	{
-		gtk_tree_store_append(GTK_TREE_STORE(model), &sep, &root);
-		gtk_tree_store_set(GTK_TREE_STORE(model), &sep, 0, NULL,  1, NULL,  -1);
+		GtkTreeModel	*model = build->model;
+		GtkTreeIter	iter;
+
+		/* Swap in the new file table and tree; the build gets the old ones, to be freed with it. */
+		gtk_tree_model_get_iter(model, &iter, path);
+		file_tree_finish(&build->tree, build->files.buffer);
+		if (repo->tree.nodes != NULL)
+		{
+			/* A refresh only touches the rows that changed. */
+			tree_model_update_files(model, &iter, &build->files, &build->tree);
+			msgwin_status_add(_("Refreshed repository \"%s\"; %lu files in %.1f ms."), repository_get_name(repo), (unsigned long) repo->files.num_files,
+					1e3 * g_timer_elapsed(build->timer, NULL));
+		}
+		else
+		{
+			tree_model_set_files(model, &iter, &build->files, &build->tree);
+			/* Rows expanded when the configuration was loaded can only be expanded once they're there. */
+			if (gitbrowser.expanded != NULL)
+				tree_view_set_expanded_below(GTK_TREE_VIEW(gitbrowser.view), gitbrowser.expanded, path);
+			else
+			{
+				gtk_tree_view_expand_to_path(GTK_TREE_VIEW(gitbrowser.view), path);
+				gtk_tree_view_set_cursor_on_cell(GTK_TREE_VIEW(gitbrowser.view), path, NULL, NULL, FALSE);
+			}
+			msgwin_status_add(_("Built repository \"%s\"; %lu files added in %.1f ms."), repository_get_name(repo), (unsigned long) repo->files.num_files,
+					1e3 * g_timer_elapsed(build->timer, NULL));
+		}
+		gtk_tree_path_free(path);
+
+		/* Bring the Quick Open list up to date, by what changed between the file tables. */
+		if (!repository_update_quick_open(repo, &build->files))
+			repository_drop_quick_open(repo);
 	}
+	list_build_free(build);
+	repository_list_settle();
 }
 
-/* Look for a child with the given text as its data; if not found it's added in the proper location and returned. */
-static GNode * get_child(GNode *root, const gchar *text)
+/* Sets up the repository's row in the sidebar, and starts listing its files to build its part of the tree. That goes on in
+ * the background, the tree (and the file table) are only replaced once the listing is done, in one go. The files are read
+ * from the index directly, with no need to run git, unless it's in a form that's not understood. When refreshing, nothing
+ * is read if the index hasn't changed, and otherwise only the rows that differ are changed.
+*/
+void tree_model_build_repository(GtkTreeModel *model, GtkTreeIter *repo, Repository *repository)
 {
-	GNode	*here;
-
-	if (root == NULL || text == NULL)
-		return NULL;
+	const gchar		*root_path = repository->root_path;
+	const GeanyDocument	*doc = document_get_current();
+	GtkTreeIter		new;
+	GtkTreePath		*path;
+	ListBuild		*build;
 
-	if ((here = g_node_first_child(root)) != NULL)
+	/* A new row holds the repository's place until the branch is known; a refreshed one keeps the label it had. */
+	if (repo == NULL)
 	{
-		while (here != NULL)
-		{
-			const gint	rel = strcmp(text, here->data);
-
-			if (rel == 0)
-				return here;
-			if (rel < 0)
-				return g_node_insert_data_before(root, here, (gpointer) text);
-			here = g_node_next_sibling(here);
-		}
+		repo = &new;
+		tree_model_append(model, repository, repository_get_name(repository), repo);
 	}
-	return g_node_append_data(root, (gpointer) text);
+
+	/* Now list the repository, and build a tree representation as the paths come in. */
+	repository_list_cancel(repository);
+	build = g_malloc0(sizeof *build);
+	build->repo = repository;
+	build->model = model;
+	path = gtk_tree_model_get_path(model, repo);
+	build->row = gtk_tree_row_reference_new(model, path);
+	gtk_tree_path_free(path);
+	file_tree_init(&build->tree);
+	build->timer = g_timer_new();
+	build->root_path = g_strdup(root_path);
+	memcpy(build->checksum, repository->files.checksum, sizeof build->checksum);
+	build->checksum_valid = repository->files.checksum_valid;
+	build->digest = repository->files.digest;
+	build->priority = doc != NULL && repository_find_by_path(doc->real_path) == repository ? 0 : 1;
+	build->sequence = gitbrowser.list_sequence++;
+	build->pooled = TRUE;
+	repository->list_build = build;
+	g_thread_pool_push(repository_list_pool(), build, NULL);
 }
 
-static guint tree_model_build_populate(GtkTreeModel *model, gchar *lines, GtkTreeIter *parent)
+void tree_model_build_separator(GtkTreeModel *model)
 {
-	gchar	*line, *nextline, *dir, *endptr;
-	GNode	*root = g_node_new(""), *prev;
-	guint	count;
+	GtkTreeIter	sep;
 
-	/* Let's cheat: build a GNode n:ary tree first, then use that to build GtkTreeModel data. */
-	while ((line = tok_tokenize_next(lines, &nextline, '\n')) != NULL)
-	{
-		prev = root;
-		dir = line;
-		while ((dir = tok_tokenize_next(dir, &endptr, G_DIR_SEPARATOR)) != NULL)
-		{
-			prev = get_child(prev, dir);
-			dir = endptr;
-		}
-		if (prev == root)
-			get_child(root, line);
-		lines = nextline;
-	}
-	count = tree_model_build_traverse(model, root, parent);
-	g_node_destroy(root);
-	return count;
+	tree_model_append(model, NULL, NULL, &sep);
 }
 
-/* Traverse the children of the given GNode tree, and build a corresponding GtkTreeModel.
- * The traversal order is special: inner nodes first, to group directories on top.
+/* Writes the full path of a row into <buf>, if it fits (terminator and all), and returns its length. Rows other than
+ * repositories, files and directories have an empty path. The path is put together from the end, walking up the file
+ * tree, so each component is copied just the once.
 */
-static guint tree_model_build_traverse(GtkTreeModel *model, GNode *root, GtkTreeIter *parent)
+static gsize tree_model_get_full_path(GtkTreeModel *model, const GtkTreeIter *iter, gchar *buf, gsize buf_max)
 {
-	GNode		*child;
-	GtkTreeIter	iter;
-	gchar		*dname;
-	guint		count = 0;
+	const Repository	*repo = iter->user_data;
+	gsize			len, pos;
 
-	/* Inner nodes. */
-	for (child = g_node_first_child(root); child != NULL; child = g_node_next_sibling(child))
+	if (repo == NULL)
 	{
-		if (g_node_first_child(child) == NULL)
-			continue;
-		/* We now know this is an inner node; add tree node and recurse. */
-		gtk_tree_store_append(GTK_TREE_STORE(model), &iter, parent);
-		dname = g_filename_display_name(child->data);
-		gtk_tree_store_set(GTK_TREE_STORE(model), &iter, 0, dname, 1, child->data, -1);
-		g_free(dname);
-		count += tree_model_build_traverse(model, child, &iter);	/* Don't count inner node itself. */
+		if (buf_max > 0)
+			*buf = '\0';
+		return 0;
 	}
-	/* Leaves. */
-	for (child = g_node_first_child(root); child != NULL; child = g_node_next_sibling(child))
+	len = strlen(repo->root_path);
+	for (guint32 node = SIDEBAR_ITER_NODE(iter); node != 0; node = repo->tree.nodes[node].parent)
+		len += 1 + strcspn(repo->files.buffer + repo->tree.nodes[node].name, "/");
+	if (len >= buf_max)
+		return len;
+
+	buf[pos = len] = '\0';
+	for (guint32 node = SIDEBAR_ITER_NODE(iter); node != 0; node = repo->tree.nodes[node].parent)
 	{
-		if (g_node_first_child(child) != NULL)
-			continue;
-		gtk_tree_store_append(GTK_TREE_STORE(model), &iter, parent);
-		dname = g_filename_display_name(child->data);
-		gtk_tree_store_set(GTK_TREE_STORE(model), &iter, 0, dname, 1, child->data,-1);
-		g_free(dname);
-		count += 1;
+		const gchar	*component = repo->files.buffer + repo->tree.nodes[node].name;
+		const gsize	clen = strcspn(component, "/");
+
+		pos -= clen;
+		memcpy(buf + pos, component, clen);
+		buf[--pos] = G_DIR_SEPARATOR;
 	}
-	return count;
+	memcpy(buf, repo->root_path, pos);
+	return len;
 }
 
 gboolean tree_model_open_document(GtkTreeModel *model, GtkTreePath *path)
 {
-	GtkTreeIter	iter, child;
+	GtkTreeIter	iter;
 
 	if (gtk_tree_model_get_iter(model, &iter, path))
 	{
-		GString	*path = g_string_sized_new(1024);
-		gchar	*component;
+		const gsize	len = tree_model_get_full_path(model, &iter, NULL, 0);
+		gchar		*fn = g_malloc(len + 1);
 
-		/* Walk towards the root, building the filename as we go. */
-		do
-		{
-			gtk_tree_model_get(model, &iter, 1, &component, -1);
-			if (component != NULL)
-			{
-				if (path->len > 0)
-					g_string_prepend(path, G_DIR_SEPARATOR_S);
-				g_string_prepend(path, component);
-				g_free(component);
-			}
-			child = iter;
-		} while (gtk_tree_model_iter_parent(model, &iter, &child));
-		document_open_file(path->str, FALSE, NULL, NULL);
-		g_string_free(path, TRUE);
+		tree_model_get_full_path(model, &iter, fn, len + 1);
+		document_open_file(fn, FALSE, NULL, NULL);
+		g_free(fn);
 		return TRUE;
 	}
 	return FALSE;
@@ -1633,31 +5166,9 @@ gboolean tree_model_open_document(GtkTreeModel *model, GtkTreePath *path)
 /* Gets the full path, in the local system's encoding, for the indicated document. Returns FALSE if given an inner node. */
 gboolean tree_model_get_document_path(GtkTreeModel *model, const GtkTreeIter *iter, gchar *buf, gsize buf_max)
 {
-	const gboolean	inner = gtk_tree_model_iter_has_child(model, (GtkTreeIter *) iter);
-	GString		*path = g_string_sized_new(1024);
-	GtkTreeIter	here = *iter, child;
-
-	/* Walk towards the root, building the filename as we go. */
-	do
-	{
-		gchar	*component = NULL;
-
-		gtk_tree_model_get(model, &here, 1, &component, -1);
-		if (component != NULL)
-		{
-			if (path->len > 0)
-				g_string_prepend(path, G_DIR_SEPARATOR_S);
-			g_string_prepend(path, component);
-			g_free(component);
-		}
-		child = here;
-	} while (gtk_tree_model_iter_parent(model, &here, &child));
-
-	if (g_strlcpy(buf, path->str, buf_max) >= buf_max)
+	if (tree_model_get_full_path(model, iter, buf, buf_max) >= buf_max && buf_max > 0)
 		*buf = '\0';
-	g_string_free(path, TRUE);
-
-	return inner;
+	return gtk_tree_model_iter_has_child(model, (GtkTreeIter *) iter);
 }
 
 void tree_model_foreach(GtkTreeModel *model, GtkTreeIter *root, void (*node_callback)(GtkTreeModel *model, GtkTreePath *path, GtkTreeIter *iter, gpointer user), gpointer user)
@@ -1756,6 +5267,8 @@ static void menu_popup_directory(GdkEventButton *evt)
 {
 	GtkWidget	*menu = menu_popup_create();
 
+	gtk_menu_shell_append(GTK_MENU_SHELL(menu), gitbrowser.cmd_menu_items[CMD_DIR_OPEN_QUICK]);
+	gtk_menu_shell_append(GTK_MENU_SHELL(menu), gtk_separator_menu_item_new());
 	gtk_menu_shell_append(GTK_MENU_SHELL(menu), gitbrowser.cmd_menu_items[CMD_DIR_EXPAND]);
 	gtk_menu_shell_append(GTK_MENU_SHELL(menu), gitbrowser.cmd_menu_items[CMD_DIR_COLLAPSE]);
 	gtk_menu_shell_append(GTK_MENU_SHELL(menu), gtk_separator_menu_item_new());
@@ -1948,19 +5461,11 @@ static void open_quick_reset_filter(void)
 	else
 		gitbrowser.quick_open_hide = NULL;
 
-	/* Because the filter might have changed, we need to go through and re-populate all the lists. */
+	/* Because the filter might have changed, all the lists are stale. Drop them, they're re-built when next needed. */
 	if ((repos = g_hash_table_get_values(gitbrowser.repositories)) != NULL)
 	{
 		for (iter = repos; iter != NULL; iter = g_list_next(iter))
-		{
-			Repository	*repo = iter->data;
-
-			if (repo->quick_open.dialog != NULL)
-			{
-				repository_to_list(repo, gitbrowser.model, &repo->quick_open);
-				open_quick_update_label(&repo->quick_open);
-			}
-		}
+			repository_drop_quick_open(iter->data);
 		g_list_free(repos);
 	}
 }
@@ -1988,6 +5493,8 @@ static gboolean gitbrowser_init(GeanyPlugin *plugin, gpointer pdata)
 
 	init_commands(gitbrowser.cmd_menu_items);
 
+	/* The sidebar's model is a type of our own, which GLib can't forget about if the plugin is unloaded. */
+	plugin_module_make_resident(plugin);
 	gitbrowser.model = tree_model_new();
 	gitbrowser.view = tree_view_new(gitbrowser.model);
 	gitbrowser.repositories = g_hash_table_new(g_str_hash, g_str_equal);
@@ -1995,6 +5502,9 @@ static gboolean gitbrowser_init(GeanyPlugin *plugin, gpointer pdata)
 	gitbrowser.quick_open_hide = NULL;
 	gitbrowser.terminal_cmd = "gnome-terminal";
 	gitbrowser.add_dialog = NULL;
+	memset(&gitbrowser.quick_open, 0, sizeof gitbrowser.quick_open);
+	gitbrowser.quick_open_memory_budget = 64;
+	gitbrowser.quick_open_max_rows = 200;
 
 	gitbrowser.key_group = plugin_set_key_group(gitbrowser.plugin, MNEMONIC_NAME, NUM_KEYS, cb_key_group_callback);
 	keybindings_set_item(gitbrowser.key_group, KEY_REPOSITORY_OPEN_QUICK_FROM_DOCUMENT, NULL, GDK_KEY_o, GDK_MOD1_MASK | GDK_SHIFT_MASK, "repository-open-quick-from-document", _("Quick Open from Document"), gitbrowser.cmd_menu_items[CMD_REPOSITORY_OPEN_QUICK_FROM_DOCUMENT]);
@@ -2008,6 +5518,10 @@ static gboolean gitbrowser_init(GeanyPlugin *plugin, gpointer pdata)
 	gitbrowser.prefs = stash_group_new(MNEMONIC_NAME);
 	stash_group_add_entry(gitbrowser.prefs, &gitbrowser.quick_open_hide_src, CFG_QUICK_OPEN_HIDE_SRC, NULL, CFG_QUICK_OPEN_HIDE_SRC);
 	stash_group_add_spin_button_integer(gitbrowser.prefs, &gitbrowser.quick_open_filter_max_time, CFG_QUICK_OPEN_FILTER_MAX_TIME, 50, CFG_QUICK_OPEN_FILTER_MAX_TIME);
+	stash_group_add_spin_button_integer(gitbrowser.prefs, &gitbrowser.quick_open_memory_budget, CFG_QUICK_OPEN_MEMORY_BUDGET, 64, CFG_QUICK_OPEN_MEMORY_BUDGET);
+	stash_group_add_spin_button_integer(gitbrowser.prefs, &gitbrowser.quick_open_max_rows, CFG_QUICK_OPEN_MAX_ROWS, 200, CFG_QUICK_OPEN_MAX_ROWS);
+	stash_group_add_toggle_button(gitbrowser.prefs, &gitbrowser.quick_open_preview, CFG_QUICK_OPEN_PREVIEW, FALSE, CFG_QUICK_OPEN_PREVIEW);
+	stash_group_add_toggle_button(gitbrowser.prefs, &gitbrowser.quick_open_untracked, CFG_QUICK_OPEN_UNTRACKED, FALSE, CFG_QUICK_OPEN_UNTRACKED);
 	stash_group_add_entry(gitbrowser.prefs, &gitbrowser.terminal_cmd, CFG_TERMINAL_CMD, "gnome-terminal", CFG_TERMINAL_CMD);
 
 	repository_load_all();
@@ -2049,6 +5563,22 @@ static GtkWidget * gitbrowser_configure(GeanyPlugin *plugin, GtkDialog *dialog,
 	prefs_widgets.filter_time = gtk_spin_button_new_with_range(10, 400, 5);
 	gtk_grid_attach(GTK_GRID(grid), prefs_widgets.filter_time, 1, 1, 1, 1);
 	ui_hookup_widget(GTK_WIDGET(dialog), prefs_widgets.filter_time, CFG_QUICK_OPEN_FILTER_MAX_TIME);
+	label = gtk_label_new(_("Memory for all lists (MB)"));
+	gtk_grid_attach(GTK_GRID(grid), label, 0, 2, 1, 1);
+	prefs_widgets.memory_budget = gtk_spin_button_new_with_range(4, 4096, 4);
+	gtk_grid_attach(GTK_GRID(grid), prefs_widgets.memory_budget, 1, 2, 1, 1);
+	ui_hookup_widget(GTK_WIDGET(dialog), prefs_widgets.memory_budget, CFG_QUICK_OPEN_MEMORY_BUDGET);
+	label = gtk_label_new(_("Show at most (matches)"));
+	gtk_grid_attach(GTK_GRID(grid), label, 0, 3, 1, 1);
+	prefs_widgets.max_rows = gtk_spin_button_new_with_range(10, 10000, 10);
+	gtk_grid_attach(GTK_GRID(grid), prefs_widgets.max_rows, 1, 3, 1, 1);
+	ui_hookup_widget(GTK_WIDGET(dialog), prefs_widgets.max_rows, CFG_QUICK_OPEN_MAX_ROWS);
+	prefs_widgets.preview = gtk_check_button_new_with_label(_("Preview the highlighted file"));
+	gtk_grid_attach(GTK_GRID(grid), prefs_widgets.preview, 0, 4, 2, 1);
+	ui_hookup_widget(GTK_WIDGET(dialog), prefs_widgets.preview, CFG_QUICK_OPEN_PREVIEW);
+	prefs_widgets.untracked = gtk_check_button_new_with_label(_("Also list untracked files (not ignored)"));
+	gtk_grid_attach(GTK_GRID(grid), prefs_widgets.untracked, 0, 5, 2, 1);
+	ui_hookup_widget(GTK_WIDGET(dialog), prefs_widgets.untracked, CFG_QUICK_OPEN_UNTRACKED);
 	gtk_container_add(GTK_CONTAINER(frame), grid);
 	gtk_box_pack_start(GTK_BOX(vbox), frame, TRUE, TRUE, 0);
 
@@ -2073,8 +5603,51 @@ static void gitbrowser_cleanup(GeanyPlugin *plugin, gpointer pdata)
 {
 	repository_save_all(gitbrowser.model);
 	gtk_notebook_remove_page(GTK_NOTEBOOK(gitbrowser.plugin->geany_data->main_widgets->sidebar_notebook), gitbrowser.page);
+	g_object_unref(gitbrowser.model);
 	stash_group_free(gitbrowser.prefs);
 	g_free(gitbrowser.config_filename);
+	repository_free_all();
+	g_free(gitbrowser.expanded);
+	gitbrowser.expanded = NULL;
+	if (gitbrowser.symbol_pool != NULL)
+		g_thread_pool_free(gitbrowser.symbol_pool, FALSE, TRUE);
+	/* Builds still queued are dropped, not run, and the ones that did run may not have been handed back yet. Either way
+	 * they've been cancelled above, so they're all in the list.
+	*/
+	if (gitbrowser.list_pool != NULL)
+	{
+		g_thread_pool_free(gitbrowser.list_pool, TRUE, TRUE);
+		gitbrowser.list_pool = NULL;
+	}
+	for (GSList *iter = gitbrowser.list_cancelled; iter != NULL; iter = g_slist_next(iter))
+	{
+		g_idle_remove_by_data(iter->data);
+		list_build_free(iter->data);
+	}
+	g_slist_free(gitbrowser.list_cancelled);
+	gitbrowser.list_cancelled = NULL;
+	if (gitbrowser.quick_open.dialog != NULL)
+	{
+		open_quick_preview_stop(&gitbrowser.quick_open);
+		if (gitbrowser.quick_open.filter_regex != NULL)
+		{
+			g_regex_unref(gitbrowser.quick_open.filter_regex);
+			g_strfreev(gitbrowser.quick_open.filter_literals);
+		}
+		if (gitbrowser.quick_open.filter_ac != NULL)
+		{
+			ahocorasick_free(gitbrowser.quick_open.filter_ac);
+			open_quick_filter_spill_clear(&gitbrowser.quick_open);
+		}
+		g_strfreev(gitbrowser.quick_open.filter_extensions);
+		g_free(gitbrowser.quick_open.filter_mask);
+		gtk_widget_destroy(gitbrowser.quick_open.dialog);
+		g_object_unref(gitbrowser.quick_open.store);
+		g_free(gitbrowser.quick_open.shown);
+		g_free(gitbrowser.quick_open.scope);
+		g_free(gitbrowser.quick_open.scope_prefix);
+		g_free(gitbrowser.quick_open.scope_rows);
+	}
 	g_hash_table_destroy(gitbrowser.repositories);
 }
 
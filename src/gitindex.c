@@ -0,0 +1,244 @@
+/*
+ * Reading git's index file directly, to list a repository's files without running git.
+ *
+ * The index is a header, a sorted list of entries (one per path and stage), some extensions, and a
+ * checksum of all that. Each entry has the file's stat data, its object ID, some flags, and its path.
+ * In versions 2 and 3, the path is stored in full and the entry padded to a multiple of eight bytes;
+ * version 4 drops the padding and stores only how much of the previous entry's path to keep, and the
+ * rest. The file is mapped rather than read, so walking it costs no more than the entries in it.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include "gitindex.h"
+
+#define	HEADER_SIZE	12
+#define	ENTRY_FIXED	(40 + GITINDEX_OID_SIZE + 2)	/* Stat data, object ID and flags. */
+
+#define	FLAG_EXTENDED		0x4000
+#define	FLAG_STAGE_MASK		0x3000
+#define	FLAG_STAGE_SHIFT	12
+#define	FLAG_NAME_MASK		0x0fff
+#define	EXTENDED_SKIP_WORKTREE	0x4000
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+static guint32 get_be32(const guint8 *p)
+{
+	return ((guint32) p[0] << 24) | ((guint32) p[1] << 16) | ((guint32) p[2] << 8) | p[3];
+}
+
+static guint16 get_be16(const guint8 *p)
+{
+	return ((guint16) p[0] << 8) | p[1];
+}
+
+/* Decodes one of git's variable-length integers, as used for version 4 path compression. Each byte holds seven bits, most
+ * significant first, with the top bit set on all but the last; every continuation also adds one, so no value has two
+ * encodings. Returns the position after it, or NULL if it runs past <end> or overflows.
+*/
+static const guint8 * get_varint(const guint8 *p, const guint8 *end, gsize *value)
+{
+	gsize	v;
+
+	if (p >= end)
+		return NULL;
+	v = *p & 0x7f;
+	while (*p++ & 0x80)
+	{
+		if (p >= end || v >= G_MAXSIZE >> 8)
+			return NULL;
+		v = ((v + 1) << 7) | (*p & 0x7f);
+	}
+	*value = v;
+	return p;
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+/* Reads the entry at <pos> into <entry>, and returns the position of the next, or NULL if it doesn't make sense. In version 4,
+ * <path> holds the previous entry's path, and is built on for this one; otherwise the path is pointed at where it is.
+*/
+static const guint8 * read_entry(const guint8 *pos, const guint8 *end, guint32 version, GString *path, GitIndexEntry *entry)
+{
+	const guint8	*name, *nul;
+	guint16		flags;
+	gsize		fixed = ENTRY_FIXED;
+
+	if (pos + ENTRY_FIXED > end)
+		return NULL;
+	entry->ctime_sec = get_be32(pos);
+	entry->ctime_nsec = get_be32(pos + 4);
+	entry->mtime_sec = get_be32(pos + 8);
+	entry->mtime_nsec = get_be32(pos + 12);
+	entry->dev = get_be32(pos + 16);
+	entry->ino = get_be32(pos + 20);
+	entry->mode = get_be32(pos + 24);
+	entry->uid = get_be32(pos + 28);
+	entry->gid = get_be32(pos + 32);
+	entry->size = get_be32(pos + 36);
+	entry->oid = pos + 40;
+	flags = get_be16(pos + 40 + GITINDEX_OID_SIZE);
+	entry->stage = (flags & FLAG_STAGE_MASK) >> FLAG_STAGE_SHIFT;
+	entry->skip_worktree = FALSE;
+	if (flags & FLAG_EXTENDED)
+	{
+		if (version < 3 || pos + ENTRY_FIXED + 2 > end)
+			return NULL;
+		entry->skip_worktree = (get_be16(pos + ENTRY_FIXED) & EXTENDED_SKIP_WORKTREE) != 0;
+		fixed += 2;
+	}
+	name = pos + fixed;
+
+	if (version == 4)
+	{
+		gsize	strip;
+
+		if ((name = get_varint(name, end, &strip)) == NULL || strip > path->len)
+			return NULL;
+		if ((nul = memchr(name, '\0', end - name)) == NULL)
+			return NULL;
+		g_string_truncate(path, path->len - strip);
+		g_string_append_len(path, (const gchar *) name, nul - name);
+		entry->path = path->str;
+		entry->path_len = path->len;
+		return nul + 1;
+	}
+
+	/* Long names don't fit the flags, and have to be measured. */
+	if ((flags & FLAG_NAME_MASK) < FLAG_NAME_MASK)
+	{
+		nul = name + (flags & FLAG_NAME_MASK);
+		if (nul >= end || *nul != '\0')
+			return NULL;
+	}
+	else if ((nul = memchr(name, '\0', end - name)) == NULL)
+		return NULL;
+	entry->path = (const gchar *) name;
+	entry->path_len = nul - name;
+	/* One to eight terminators pad the entry to a multiple of eight bytes. */
+	pos += (fixed + entry->path_len + 8) & ~(gsize) 7;
+	return pos <= end ? pos : NULL;
+}
+
+static gboolean read_index(const guint8 *data, gsize size, GitIndexCallback callback, gpointer user)
+{
+	const guint8	*end, *pos;
+	guint32		version, count;
+	GString		*path;
+
+	if (size < HEADER_SIZE + GITINDEX_OID_SIZE || memcmp(data, "DIRC", 4) != 0)
+		return FALSE;
+	version = get_be32(data + 4);
+	count = get_be32(data + 8);
+	if (version < 2 || version > 4)
+		return FALSE;
+
+	/* Entries and extensions both end where the checksum begins. */
+	end = data + size - GITINDEX_OID_SIZE;
+	pos = data + HEADER_SIZE;
+	path = g_string_sized_new(256);
+	for (guint32 i = 0; i < count && pos != NULL; i++)
+	{
+		GitIndexEntry	entry;
+
+		if ((pos = read_entry(pos, end, version, path, &entry)) != NULL)
+			callback(&entry, user);
+	}
+	g_string_free(path, TRUE);
+	if (pos == NULL)
+		return FALSE;
+
+	/* Extensions with an upper-case signature can be ignored; the others change what the entries mean. */
+	while (pos + 8 <= end)
+	{
+		const guint32	ext_size = get_be32(pos + 4);
+
+		if (pos[0] < 'A' || pos[0] > 'Z' || ext_size > (gsize) (end - pos) - 8)
+			return FALSE;
+		pos += 8 + ext_size;
+	}
+	return pos == end;
+}
+
+/* An index written with index.skipHash (which feature.manyFiles turns on) has no checksum, just zeros where it would be.
+ * Its size and modification time stand in for it then; git writes a new file and renames it over the index, so those
+ * change along with it. They're never all zeros, since no index is empty.
+*/
+static gboolean stat_checksum(const gchar *filename, guint8 *checksum)
+{
+	GFile		*file = g_file_new_for_path(filename);
+	GFileInfo	*info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+						G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	guint64		size, sec;
+	guint32		usec;
+
+	g_object_unref(file);
+	if (info == NULL)
+		return FALSE;
+	size = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+	sec = g_file_info_get_attribute_uint64(info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	usec = g_file_info_get_attribute_uint32(info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	g_object_unref(info);
+	memcpy(checksum, &size, sizeof size);
+	memcpy(checksum + sizeof size, &sec, sizeof sec);
+	memcpy(checksum + sizeof size + sizeof sec, &usec, sizeof usec);
+	return TRUE;
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+gboolean gitindex_read(const gchar *filename, GitIndexCallback callback, gpointer user)
+{
+	GMappedFile	*mf;
+	gboolean	ok;
+
+	if ((mf = g_mapped_file_new(filename, FALSE, NULL)) == NULL)
+		return FALSE;
+	ok = read_index((const guint8 *) g_mapped_file_get_contents(mf), g_mapped_file_get_length(mf), callback, user);
+	g_mapped_file_unref(mf);
+	return ok;
+}
+
+gboolean gitindex_checksum(const gchar *filename, guint8 *checksum)
+{
+	GMappedFile	*mf;
+	const guint8	*data;
+	gsize		size;
+	gboolean	ok;
+
+	if ((mf = g_mapped_file_new(filename, FALSE, NULL)) == NULL)
+		return FALSE;
+	data = (const guint8 *) g_mapped_file_get_contents(mf);
+	size = g_mapped_file_get_length(mf);
+	if ((ok = size >= HEADER_SIZE + GITINDEX_OID_SIZE && memcmp(data, "DIRC", 4) == 0))
+		memcpy(checksum, data + size - GITINDEX_OID_SIZE, GITINDEX_OID_SIZE);
+	g_mapped_file_unref(mf);
+	if (ok)
+	{
+		static const guint8	zeros[GITINDEX_OID_SIZE];
+
+		if (memcmp(checksum, zeros, sizeof zeros) == 0)
+			ok = stat_checksum(filename, checksum);
+	}
+	return ok;
+}
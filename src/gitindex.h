@@ -0,0 +1,55 @@
+/*
+ * Reading git's index file directly, to list a repository's files without running git.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <glib.h>
+
+/* Only SHA-1 repositories are understood; with SHA-256 the entries won't add up, and reading fails. */
+#define	GITINDEX_OID_SIZE	20
+
+/* One entry, as handed to the callback. The path is repository-relative, with '/' separators, and terminated. It (and
+ * the object ID) are only valid during the call.
+*/
+typedef struct {
+	const gchar	*path;
+	gsize		path_len;
+	guint32		ctime_sec, ctime_nsec;
+	guint32		mtime_sec, mtime_nsec;
+	guint32		dev, ino, mode, uid, gid, size;
+	const guint8	*oid;
+	guint		stage;			/* 0, or 1 to 3 for the sides of an unresolved conflict. */
+	gboolean	skip_worktree;
+} GitIndexEntry;
+
+typedef void (*GitIndexCallback)(const GitIndexEntry *entry, gpointer user);
+
+/* Reads the index in <filename>, calling <callback> for each entry in order. Versions 2, 3 and 4 are understood, along with
+ * any optional extension (those are skipped). Returns FALSE if the file can't be read, is damaged, or needs something else,
+ * like a split index; the callback may have been called for some entries by then. This only reads the file, so any thread
+ * will do.
+*/
+gboolean	gitindex_read(const gchar *filename, GitIndexCallback callback, gpointer user);
+
+/* Puts just the checksum of the index in <filename> in <checksum>, without reading the entries; a cheap way to tell if
+ * it's changed since it was last read. It changes whenever the index does, and is never all zeros: an index without a
+ * checksum of its own gets one made from its size and modification time. Take it before reading the index, so a change
+ * in between is seen next time. Returns FALSE if it's not an index at all.
+*/
+gboolean	gitindex_checksum(const gchar *filename, guint8 *checksum);
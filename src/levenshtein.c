@@ -42,19 +42,32 @@ void levenshtein_begin_half(LDState *state, const gchar *s1)
 	state->half_len = strlen(s1);
 }
 
-static guint16 compute(LDState *state, const gchar *s1, guint16 i, guint16 len1, const gchar *s2, guint16 j, guint16 len2)
+/* Computes the distance one row of the matrix at a time, which takes time in proportion to the product of the lengths.
+ * The row is indexed by <s1>, which should be the shorter string.
+*/
+static guint16 compute(LDState *state, const gchar *s1, gsize len1, const gchar *s2, gsize len2)
 {
-	if (len1 == 0)
-		return len2;
-	if (len2 == 0)
-		return len1;
-		
-	const guint16 cost = (s1[i] != s2[j]);
-	const guint16 d1 = compute(state, s1, i + 1, len1 - 1, s2, j, len2) + 1;
-	const guint16 d2 = compute(state, s1, i,     len1,     s2, j + 1, len2 - 1) + 1;
-	const guint16 d3 = compute(state, s1, i + 1, len1 - 1, s2, j + 1, len2 - 1) + cost;
-	const guint16 dist = MIN(d1, MIN(d2, d3));
-	
+	guint16	*row = len1 < LD_ROW_MAX ? state->row : g_new(guint16, len1 + 1), dist;
+
+	for (gsize i = 0; i <= len1; i++)
+		row[i] = i;
+	for (gsize j = 1; j <= len2; j++)
+	{
+		guint16	diag = row[0];
+
+		row[0] = j;
+		for (gsize i = 1; i <= len1; i++)
+		{
+			const guint16	up = row[i];
+			const guint16	cost = s1[i - 1] != s2[j - 1];
+
+			row[i] = MIN(MIN(up, row[i - 1]) + 1, diag + cost);
+			diag = up;
+		}
+	}
+	dist = row[len1];
+	if (row != state->row)
+		g_free(row);
 	return dist;
 }
 
@@ -62,14 +75,17 @@ guint16 levenshtein_compute(LDState *state, const gchar *s1, const gchar *s2)
 {
 	if(s1 == NULL || s2 == NULL)
 		return 0;
-	return compute(state, s1, 0, strlen(s1), s2, 0, strlen(s2));
+	const gsize	len1 = strlen(s1), len2 = strlen(s2);
+
+	/* The distance is symmetric, so keep the row as short as possible. */
+	return len1 <= len2 ? compute(state, s1, len1, s2, len2) : compute(state, s2, len2, s1, len1);
 }
 
 guint16 levenshtein_compute_half(LDState *state, const gchar *s2)
 {
 	if(s2 == NULL)
 		return 0;
-	return compute(state, state->half_str, 0, state->half_len, s2, 0, strlen(s2));
+	return compute(state, state->half_str, state->half_len, s2, strlen(s2));
 }
 
 void levenshtein_end(LDState *state)
@@ -21,9 +21,13 @@
 
 #include <glib.h>
 
+/* Strings up to this long (the shorter one of the two) are compared without allocating memory. */
+#define	LD_ROW_MAX	256
+
 typedef struct {
 	const gchar	*half_str;
 	guint16		half_len;
+	guint16		row[LD_ROW_MAX];	/* One row of the distance matrix, all that is needed at a time. */
 } LDState;
 
 void		levenshtein_begin(LDState *state);
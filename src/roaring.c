@@ -0,0 +1,273 @@
+/*
+ * Compressed bitmaps of 32-bit integers, in the style of Roaring bitmaps.
+ *
+ * These are used to keep track of which Quick Open rows have a given file name extension. Most
+ * extensions are rare, so most containers are short sorted arrays of 16-bit values, but the common
+ * ones ("c", "h", "py" ...) cover long dense runs of rows, which get a plain bitmap instead. Either
+ * way, turning a set into the index's row bitset costs time in proportion to the set's size, not to
+ * the number of rows.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "roaring.h"
+
+/* An array of more than this many 16-bit values is larger than a bitmap of all 65536 of them. */
+#define	ARRAY_MAX	4096
+#define	BITMAP_WORDS	(65536 / 32)
+
+struct RoaringContainer
+{
+	guint16		key;			/* The upper 16 bits of all values in here. */
+	guint32		cardinality;
+	guint32		max;			/* Allocated size of 'array', or zero if this is a bitmap. */
+	union {
+		guint16	*array;			/* Sorted lower halves. */
+		guint32	*bitmap;		/* BITMAP_WORDS words. */
+	} u;
+};
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+/* Finds the container for <key>, or where it should go, by binary search. Returns TRUE if found. */
+static gboolean find_container(const RoaringBitmap *rb, guint16 key, guint32 *pos)
+{
+	guint32	lo = 0, hi = rb->num_containers;
+
+	while (lo < hi)
+	{
+		const guint32	mid = (lo + hi) / 2;
+
+		if (rb->containers[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*pos = lo;
+	return lo < rb->num_containers && rb->containers[lo].key == key;
+}
+
+/* Finds <low> in a container's array, or where it should go. Values are mostly added in increasing order, so check the end first. */
+static gboolean find_value(const RoaringContainer *c, guint16 low, guint32 *pos)
+{
+	guint32	lo = 0, hi = c->cardinality;
+
+	if (hi > 0 && c->u.array[hi - 1] < low)
+	{
+		*pos = hi;
+		return FALSE;
+	}
+	while (lo < hi)
+	{
+		const guint32	mid = (lo + hi) / 2;
+
+		if (c->u.array[mid] < low)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*pos = lo;
+	return lo < c->cardinality && c->u.array[lo] == low;
+}
+
+static void container_to_bitmap(RoaringContainer *c)
+{
+	guint32	*bitmap = g_new0(guint32, BITMAP_WORDS);
+
+	for (guint32 i = 0; i < c->cardinality; i++)
+		bitmap[c->u.array[i] >> 5] |= 1u << (c->u.array[i] & 31);
+	g_free(c->u.array);
+	c->u.bitmap = bitmap;
+	c->max = 0;
+}
+
+static void container_to_array(RoaringContainer *c)
+{
+	guint16	*array = g_new(guint16, c->cardinality), *put = array;
+
+	for (guint32 w = 0; w < BITMAP_WORDS; w++)
+	{
+		for (guint32 bits = c->u.bitmap[w]; bits != 0; bits &= bits - 1)
+			*put++ = 32 * w + g_bit_nth_lsf(bits, -1);
+	}
+	g_free(c->u.bitmap);
+	c->u.array = array;
+	c->max = c->cardinality;
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+RoaringBitmap * roaring_new(void)
+{
+	return g_new0(RoaringBitmap, 1);
+}
+
+void roaring_free(RoaringBitmap *rb)
+{
+	if (rb == NULL)
+		return;
+	for (guint32 i = 0; i < rb->num_containers; i++)
+		g_free(rb->containers[i].max == 0 ? (gpointer) rb->containers[i].u.bitmap : (gpointer) rb->containers[i].u.array);
+	g_free(rb->containers);
+	g_free(rb);
+}
+
+gsize roaring_memory(const RoaringBitmap *rb)
+{
+	gsize	size = sizeof *rb + rb->max_containers * sizeof *rb->containers;
+
+	for (guint32 i = 0; i < rb->num_containers; i++)
+		size += rb->containers[i].max == 0 ? BITMAP_WORDS * sizeof (guint32) : rb->containers[i].max * sizeof (guint16);
+	return size;
+}
+
+void roaring_add(RoaringBitmap *rb, guint32 value)
+{
+	const guint16		key = value >> 16, low = value & 0xffff;
+	RoaringContainer	*c;
+	guint32			pos;
+
+	if (!find_container(rb, key, &pos))
+	{
+		if (rb->num_containers == rb->max_containers)
+		{
+			rb->max_containers = rb->max_containers == 0 ? 4 : 2 * rb->max_containers;
+			rb->containers = g_renew(RoaringContainer, rb->containers, rb->max_containers);
+		}
+		memmove(rb->containers + pos + 1, rb->containers + pos, (rb->num_containers - pos) * sizeof *rb->containers);
+		rb->num_containers++;
+		c = rb->containers + pos;
+		c->key = key;
+		c->cardinality = 0;
+		c->max = 4;
+		c->u.array = g_new(guint16, c->max);
+	}
+	else
+		c = rb->containers + pos;
+
+	if (c->max == 0)
+	{
+		if ((c->u.bitmap[low >> 5] & (1u << (low & 31))) == 0)
+		{
+			c->u.bitmap[low >> 5] |= 1u << (low & 31);
+			c->cardinality++;
+		}
+		return;
+	}
+	if (find_value(c, low, &pos))
+		return;
+	if (c->cardinality == ARRAY_MAX)
+	{
+		container_to_bitmap(c);
+		c->u.bitmap[low >> 5] |= 1u << (low & 31);
+		c->cardinality++;
+		return;
+	}
+	if (c->cardinality == c->max)
+	{
+		c->max = MIN(2 * c->max, ARRAY_MAX);
+		c->u.array = g_renew(guint16, c->u.array, c->max);
+	}
+	memmove(c->u.array + pos + 1, c->u.array + pos, (c->cardinality - pos) * sizeof *c->u.array);
+	c->u.array[pos] = low;
+	c->cardinality++;
+}
+
+void roaring_remove(RoaringBitmap *rb, guint32 value)
+{
+	const guint16		key = value >> 16, low = value & 0xffff;
+	RoaringContainer	*c;
+	guint32			pos;
+
+	if (!find_container(rb, key, &pos))
+		return;
+	c = rb->containers + pos;
+	if (c->max == 0)
+	{
+		if ((c->u.bitmap[low >> 5] & (1u << (low & 31))) == 0)
+			return;
+		c->u.bitmap[low >> 5] &= ~(1u << (low & 31));
+		if (--c->cardinality <= ARRAY_MAX / 2)	/* Leave some slack, so a value going back and forth doesn't convert each time. */
+			container_to_array(c);
+		return;
+	}
+	if (!find_value(c, low, &pos))
+		return;
+	memmove(c->u.array + pos, c->u.array + pos + 1, (c->cardinality - pos - 1) * sizeof *c->u.array);
+	if (--c->cardinality == 0)
+	{
+		g_free(c->u.array);
+		memmove(rb->containers + (c - rb->containers), c + 1, (rb->num_containers - (c - rb->containers) - 1) * sizeof *rb->containers);
+		rb->num_containers--;
+	}
+}
+
+gboolean roaring_contains(const RoaringBitmap *rb, guint32 value)
+{
+	const guint16	low = value & 0xffff;
+	guint32		pos;
+
+	if (!find_container(rb, value >> 16, &pos))
+		return FALSE;
+	if (rb->containers[pos].max == 0)
+		return (rb->containers[pos].u.bitmap[low >> 5] >> (low & 31)) & 1;
+	return find_value(rb->containers + pos, low, &pos);
+}
+
+guint32 roaring_cardinality(const RoaringBitmap *rb)
+{
+	guint32	count = 0;
+
+	for (guint32 i = 0; i < rb->num_containers; i++)
+		count += rb->containers[i].cardinality;
+	return count;
+}
+
+void roaring_or_into_bitset(const RoaringBitmap *rb, guint32 *bitset, guint32 bits)
+{
+	for (guint32 i = 0; i < rb->num_containers; i++)
+	{
+		const RoaringContainer	*c = rb->containers + i;
+		const guint32		base = (guint32) c->key << 16;
+
+		if (base >= bits)
+			break;
+		if (c->max == 0)
+		{
+			/* The container is aligned to a whole number of words, so this is a straight OR. */
+			const guint32	words = MIN(BITMAP_WORDS, (bits - base + 31) / 32);
+			guint32		*put = bitset + base / 32;
+
+			for (guint32 w = 0; w < words; w++)
+				put[w] |= c->u.bitmap[w];
+		}
+		else
+		{
+			for (guint32 j = 0; j < c->cardinality; j++)
+			{
+				const guint32	value = base + c->u.array[j];
+
+				if (value >= bits)
+					break;
+				bitset[value >> 5] |= 1u << (value & 31);
+			}
+		}
+	}
+}
@@ -0,0 +1,45 @@
+/*
+ * Compressed bitmaps of 32-bit integers, in the style of Roaring bitmaps.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <glib.h>
+
+typedef struct RoaringContainer	RoaringContainer;
+
+/* The values are split on their upper 16 bits, each distinct upper half getting a container for the lower halves.
+ * A container is a sorted array while it's sparse, and turns into a plain 8 KB bitmap when that becomes smaller.
+*/
+typedef struct {
+	RoaringContainer	*containers;		/* Sorted on key. */
+	guint32			num_containers;
+	guint32			max_containers;
+} RoaringBitmap;
+
+RoaringBitmap *	roaring_new(void);
+void		roaring_free(RoaringBitmap *rb);
+gsize		roaring_memory(const RoaringBitmap *rb);
+
+void		roaring_add(RoaringBitmap *rb, guint32 value);
+void		roaring_remove(RoaringBitmap *rb, guint32 value);
+gboolean	roaring_contains(const RoaringBitmap *rb, guint32 value);
+guint32		roaring_cardinality(const RoaringBitmap *rb);
+
+/* ORs the values below <bits> into a plain bitset of 32-bit words, as used by the Quick Open index. */
+void		roaring_or_into_bitset(const RoaringBitmap *rb, guint32 *bitset, guint32 bits);
@@ -0,0 +1,230 @@
+/*
+ * String table: an append-only arena of '\0'-terminated strings, with de-duplication.
+ *
+ * This is used to build the Quick Open lists, where a great many short strings (file names and
+ * directory names) need to be stored, most of them repeated. Since strings are packed into big
+ * fixed-size chunks and the de-duplication table is open-addressed, adding a string costs no
+ * allocations at all (except for a new chunk every 64 KB, or the occasional growth of the table).
+ * Chunks are never reallocated, so a big table never needs one big copy.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "strtab.h"
+
+#define	SLOTS_INITIAL	1024
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+/* FNV-1a, which is plenty good for short file names. */
+static guint32 hash_bytes(const gchar *text, gsize len)
+{
+	guint32	h = 2166136261u;
+
+	for (gsize i = 0; i < len; i++)
+	{
+		h ^= (guchar) text[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/* The same hash, of the ASCII lower-case version of the bytes, without converting them first. */
+static guint32 hash_bytes_lower(const gchar *text, gsize len)
+{
+	guint32	h = 2166136261u;
+
+	for (gsize i = 0; i < len; i++)
+	{
+		h ^= (guchar) g_ascii_tolower(text[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static void slots_insert(StrTabSlot *slots, guint32 mask, guint32 hash, guint32 id)
+{
+	guint32	i = hash & mask;
+
+	while (slots[i].id != 0)
+		i = (i + 1) & mask;
+	slots[i].hash = hash;
+	slots[i].id = id;
+}
+
+/* Double the size of the de-duplication table. The hashes are kept in the slots, so no string is touched. */
+static void slots_grow(StrTab *st)
+{
+	const guint32	old_size = st->slots_mask + 1, new_mask = 2 * old_size - 1;
+	StrTabSlot	*slots = g_new0(StrTabSlot, new_mask + 1);
+
+	for (guint32 i = 0; i < old_size; i++)
+	{
+		if (st->slots[i].id != 0)
+			slots_insert(slots, new_mask, st->slots[i].hash, st->slots[i].id);
+	}
+	g_free(st->slots);
+	st->slots = slots;
+	st->slots_mask = new_mask;
+}
+
+/* Returns a pointer to room for <len> more bytes, starting a new chunk if the current one is too full. */
+static gchar * chunk_reserve(StrTab *st, gsize len)
+{
+	if (st->fill + len > STRTAB_CHUNK_SIZE)
+	{
+		if (st->num_chunks == st->max_chunks)
+		{
+			st->max_chunks *= 2;
+			st->chunks = g_renew(gchar *, st->chunks, st->max_chunks);
+		}
+		st->chunks[st->num_chunks++] = g_malloc(STRTAB_CHUNK_SIZE);
+		st->fill = 0;
+	}
+	return st->chunks[st->num_chunks - 1] + st->fill;
+}
+
+/* Compares a stored string with the <len> bytes at <text>, taken as lower-case if <lower> is TRUE (ASCII only). */
+static gboolean equal(const gchar *here, const gchar *text, gsize len, gboolean lower)
+{
+	if (!lower)
+		return strncmp(here, text, len) == 0 && here[len] == '\0';
+	for (gsize i = 0; i < len; i++)
+	{
+		if (here[i] != g_ascii_tolower(text[i]))
+			return FALSE;
+	}
+	return here[len] == '\0';
+}
+
+/* Looks up the <len> bytes at <text>, returns id or 0 if not found. Leaves <*slot> at the proper insertion point. */
+static guint32 lookup(const StrTab *st, const gchar *text, gsize len, gboolean lower, guint32 hash, guint32 *slot)
+{
+	guint32	i = hash & st->slots_mask;
+
+	while (st->slots[i].id != 0)
+	{
+		const StrTabSlot	*s = &st->slots[i];
+
+		if (s->hash == hash && equal(strtab_get(st, s->id), text, len, lower))
+			return s->id;
+		i = (i + 1) & st->slots_mask;
+	}
+	*slot = i;
+	return 0;
+}
+
+/* Commits a string that has already been written at the end of the last chunk. */
+static guint32 commit(StrTab *st, gsize len, guint32 hash, guint32 slot)
+{
+	const guint32	id = ((st->num_chunks - 1) << STRTAB_CHUNK_BITS) | st->fill;
+
+	st->chunks[st->num_chunks - 1][st->fill + len] = '\0';
+	st->fill += len + 1;
+	st->slots[slot].hash = hash;
+	st->slots[slot].id = id;
+	if (++st->slots_used > st->slots_mask / 2)
+		slots_grow(st);
+	return id;
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+void strtab_init(StrTab *st)
+{
+	st->max_chunks = 16;
+	st->chunks = g_new(gchar *, st->max_chunks);
+	st->chunks[0] = g_malloc(STRTAB_CHUNK_SIZE);
+	st->num_chunks = 1;
+	st->slots = g_new0(StrTabSlot, SLOTS_INITIAL);
+	st->slots_mask = SLOTS_INITIAL - 1;
+	strtab_clear(st);
+}
+
+/* Forgets all strings. The first chunk and the de-duplication table are kept around for re-use. */
+void strtab_clear(StrTab *st)
+{
+	while (st->num_chunks > 1)
+		g_free(st->chunks[--st->num_chunks]);
+	st->chunks[0][0] = '\0';	/* The first string is stored at 1, which makes 0 really represent "no string". */
+	st->fill = 1;
+	memset(st->slots, 0, (st->slots_mask + 1) * sizeof *st->slots);
+	st->slots_used = 0;
+}
+
+void strtab_destroy(StrTab *st)
+{
+	while (st->num_chunks > 0)
+		g_free(st->chunks[--st->num_chunks]);
+	g_free(st->chunks);
+	st->chunks = NULL;
+	g_free(st->slots);
+	st->slots = NULL;
+}
+
+/* Returns the number of bytes of heap memory used by the table. */
+gsize strtab_memory(const StrTab *st)
+{
+	return (gsize) st->num_chunks * STRTAB_CHUNK_SIZE + st->max_chunks * sizeof *st->chunks + (st->slots_mask + 1) * sizeof *st->slots;
+}
+
+/* Adds a string to the table, unless it's already there. Returns the string's id.
+ * Strings longer than a chunk are truncated; that's far beyond any sane file name.
+*/
+guint32 strtab_intern(StrTab *st, const gchar *text, gssize len)
+{
+	const gsize	length = MIN(len < 0 ? strlen(text) : (gsize) len, STRTAB_CHUNK_SIZE - 2);
+	const guint32	hash = hash_bytes(text, length);
+	guint32		slot, id;
+
+	if ((id = lookup(st, text, length, FALSE, hash, &slot)) != 0)
+		return id;
+	memcpy(chunk_reserve(st, length + 1), text, length);
+	return commit(st, length, hash, slot);
+}
+
+/* Adds the lower-case version of a string. ASCII is looked up as if converted, and only converted straight into the chunk
+ * if it's new. Only names with non-ASCII characters in them go through the (allocating) full UTF-8 conversion.
+*/
+guint32 strtab_intern_lower(StrTab *st, const gchar *text, gssize len)
+{
+	const gsize	length = MIN(len < 0 ? strlen(text) : (gsize) len, STRTAB_CHUNK_SIZE - 2);
+	gchar		*put;
+	guint32		hash, slot, id;
+
+	for (gsize i = 0; i < length; i++)
+	{
+		if ((guchar) text[i] >= 0x80)
+		{
+			gchar	*lower = g_utf8_strdown(text, length);
+
+			id = strtab_intern(st, lower, -1);
+			g_free(lower);
+			return id;
+		}
+	}
+	hash = hash_bytes_lower(text, length);
+	if ((id = lookup(st, text, length, TRUE, hash, &slot)) != 0)
+		return id;
+	put = chunk_reserve(st, length + 1);
+	for (gsize i = 0; i < length; i++)
+		put[i] = g_ascii_tolower(text[i]);
+	return commit(st, length, hash, slot);
+}
@@ -0,0 +1,56 @@
+/*
+ * String table: an append-only arena of '\0'-terminated strings, with de-duplication.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <glib.h>
+
+#define	STRTAB_CHUNK_BITS	16
+#define	STRTAB_CHUNK_SIZE	(1u << STRTAB_CHUNK_BITS)
+#define	STRTAB_CHUNK_MASK	(STRTAB_CHUNK_SIZE - 1)
+
+typedef struct {
+	guint32		hash;
+	guint32		id;			/* Zero means the slot is free. */
+} StrTabSlot;
+
+/* Strings are identified by a 32-bit id, which holds the index of the chunk in its upper bits and
+ * the offset into that chunk in the lower. The id zero is never used, so it means "no string".
+ * Chunks are never moved or resized, so pointers returned by strtab_get() stay valid until the
+ * table is cleared.
+*/
+typedef struct {
+	gchar		**chunks;
+	guint32		num_chunks;
+	guint32		max_chunks;
+	guint32		fill;			/* Bytes used in the last chunk. */
+	StrTabSlot	*slots;			/* Open-addressing (linear probing) de-duplication table. */
+	guint32		slots_mask;
+	guint32		slots_used;
+} StrTab;
+
+void		strtab_init(StrTab *st);
+void		strtab_clear(StrTab *st);
+void		strtab_destroy(StrTab *st);
+gsize		strtab_memory(const StrTab *st);
+
+guint32		strtab_intern(StrTab *st, const gchar *text, gssize len);
+guint32		strtab_intern_lower(StrTab *st, const gchar *text, gssize len);
+
+#define		strtab_get(st, id)	((const gchar *) (st)->chunks[(id) >> STRTAB_CHUNK_BITS] + ((id) & STRTAB_CHUNK_MASK))
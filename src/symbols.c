@@ -0,0 +1,214 @@
+/*
+ * Symbol extraction: finds the names of functions, types and so on in source files, line by line.
+ *
+ * This is not a parser. It looks for the handful of line shapes that introduce a definition in
+ * most languages ("def name", "struct name", a C function name at the start of a line, and so on),
+ * which is fast, needs no external tools, and is plenty for jumping to a definition by name.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <string.h>
+
+#include "symbols.h"
+
+static const struct {
+	const gchar	*extension;
+	SymbolsLanguage	language;
+} extensions[] = {
+	{ "c", SYMBOLS_LANGUAGE_C }, { "h", SYMBOLS_LANGUAGE_C }, { "cc", SYMBOLS_LANGUAGE_C }, { "cpp", SYMBOLS_LANGUAGE_C },
+	{ "cxx", SYMBOLS_LANGUAGE_C }, { "hh", SYMBOLS_LANGUAGE_C }, { "hpp", SYMBOLS_LANGUAGE_C }, { "hxx", SYMBOLS_LANGUAGE_C },
+	{ "m", SYMBOLS_LANGUAGE_C }, { "java", SYMBOLS_LANGUAGE_C }, { "cs", SYMBOLS_LANGUAGE_C }, { "js", SYMBOLS_LANGUAGE_C },
+	{ "ts", SYMBOLS_LANGUAGE_C }, { "go", SYMBOLS_LANGUAGE_C }, { "rs", SYMBOLS_LANGUAGE_C }, { "php", SYMBOLS_LANGUAGE_C },
+	{ "swift", SYMBOLS_LANGUAGE_C }, { "kt", SYMBOLS_LANGUAGE_C }, { "scala", SYMBOLS_LANGUAGE_C }, { "vala", SYMBOLS_LANGUAGE_C },
+	{ "py", SYMBOLS_LANGUAGE_PYTHON },
+	{ "rb", SYMBOLS_LANGUAGE_RUBY },
+	{ "pl", SYMBOLS_LANGUAGE_PERL }, { "pm", SYMBOLS_LANGUAGE_PERL },
+	{ "lua", SYMBOLS_LANGUAGE_LUA },
+	{ "sh", SYMBOLS_LANGUAGE_SHELL }, { "bash", SYMBOLS_LANGUAGE_SHELL },
+};
+
+/* The words that are followed by the name of the thing being defined, per language. NULL-terminated. */
+static const gchar *keywords_c[] = { "struct", "union", "enum", "class", "interface", "namespace", "trait", "fn", "func", "function", "type", NULL };
+static const gchar *keywords_python[] = { "def", "class", NULL };
+static const gchar *keywords_ruby[] = { "def", "class", "module", NULL };
+static const gchar *keywords_perl[] = { "sub", "package", NULL };
+static const gchar *keywords_lua[] = { "function", NULL };
+static const gchar *keywords_shell[] = { "function", NULL };
+
+/* Words that look like a C function definition's name at the start of a line, but aren't. */
+static const gchar *not_functions[] = { "if", "for", "while", "switch", "return", "sizeof", "else", "do", NULL };
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+static gboolean is_ident(gchar c, SymbolsLanguage lang)
+{
+	return g_ascii_isalnum(c) || c == '_' || c == '$' || (lang == SYMBOLS_LANGUAGE_LUA && (c == '.' || c == ':')) || (guchar) c >= 0x80;
+}
+
+static gboolean word_in(const gchar *word, gsize len, const gchar **list)
+{
+	for (; *list != NULL; list++)
+	{
+		if (strncmp(*list, word, len) == 0 && (*list)[len] == '\0')
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static const gchar * skip_space(const gchar *p, const gchar *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	return p;
+}
+
+static void emit(GString *out, guint line, const gchar *name, gsize len)
+{
+	g_string_append_printf(out, "%u\t%.*s\n", line, (int) len, name);
+}
+
+/* The C function rule: a line starting in column 0 with a '(' in it, and not ending in ';' (which would make
+ * it a prototype or a statement), defines whatever name comes right before the first '('. Unless that's a
+ * keyword, as in Go's "func (r *T) Method(", which the keyword rule deals with.
+*/
+static gboolean find_c_function(const gchar *line, const gchar *end, SymbolsLanguage lang, const gchar **keywords, const gchar **name, gsize *len)
+{
+	const gchar	*paren, *last = end;
+
+	if (line == end || !is_ident(line[0], lang))
+		return FALSE;
+	while (last > line && g_ascii_isspace(last[-1]))
+		last--;
+	if (last[-1] == ';' || last[-1] == ',')
+		return FALSE;
+	if ((paren = memchr(line, '(', end - line)) == NULL)
+		return FALSE;
+	while (paren > line && (paren[-1] == ' ' || paren[-1] == '\t'))
+		paren--;
+	*len = 0;
+	for (*name = paren; *name > line && is_ident((*name)[-1], lang); (*name)--)
+		(*len)++;
+	return *len > 0 && !g_ascii_isdigit(**name) && !word_in(*name, *len, not_functions) && !word_in(*name, *len, keywords);
+}
+
+/* The keyword rule: a keyword, preceded by nothing but other words ("pub", "static", "export" ...), followed by a name. */
+static gboolean find_keyword(const gchar *p, const gchar *end, SymbolsLanguage lang, const gchar **keywords, const gchar **name, gsize *len)
+{
+	while ((p = skip_space(p, end)) < end && is_ident(*p, lang))
+	{
+		const gchar	*word = p;
+
+		while (p < end && is_ident(*p, lang))
+			p++;
+		if (!word_in(word, p - word, keywords))
+			continue;
+		p = skip_space(p, end);
+		/* Go methods have their receiver in parentheses before the name. */
+		if (p < end && *p == '(' && (p = memchr(p, ')', end - p)) != NULL)
+			p = skip_space(p + 1, end);
+		if (p == NULL || p == end || !is_ident(*p, lang))
+			return FALSE;
+		*name = p;
+		while (p < end && is_ident(*p, lang))
+			p++;
+		/* Ruby's "def self.name" defines "name". */
+		if (lang == SYMBOLS_LANGUAGE_RUBY && p - *name == 4 && strncmp(*name, "self", 4) == 0 && p < end && *p == '.')
+		{
+			for (*name = ++p; p < end && is_ident(*p, lang); p++)
+				;
+		}
+		*len = p - *name;
+		return *len > 0;
+	}
+	return FALSE;
+}
+
+/* -------------------------------------------------------------------------------------------------------------- */
+
+SymbolsLanguage symbols_language_from_filename(const gchar *filename)
+{
+	const gchar	*dot = strrchr(filename, '.');
+
+	if (dot == NULL || strchr(dot, '/') != NULL || strchr(dot, G_DIR_SEPARATOR) != NULL)
+		return SYMBOLS_LANGUAGE_NONE;
+	for (gsize i = 0; i < G_N_ELEMENTS(extensions); i++)
+	{
+		if (g_ascii_strcasecmp(dot + 1, extensions[i].extension) == 0)
+			return extensions[i].language;
+	}
+	return SYMBOLS_LANGUAGE_NONE;
+}
+
+guint symbols_extract(SymbolsLanguage lang, const gchar *text, gsize len, GString *out)
+{
+	const gchar	*end = text + len, *line, **keywords, *comment;
+	guint		line_no = 1, count = 0;
+
+	switch (lang)
+	{
+	case SYMBOLS_LANGUAGE_C:	keywords = keywords_c;		comment = "/*"; break;
+	case SYMBOLS_LANGUAGE_PYTHON:	keywords = keywords_python;	comment = "#"; break;
+	case SYMBOLS_LANGUAGE_RUBY:	keywords = keywords_ruby;	comment = "#"; break;
+	case SYMBOLS_LANGUAGE_PERL:	keywords = keywords_perl;	comment = "#"; break;
+	case SYMBOLS_LANGUAGE_LUA:	keywords = keywords_lua;	comment = "-"; break;
+	case SYMBOLS_LANGUAGE_SHELL:	keywords = keywords_shell;	comment = "#"; break;
+	default:
+		return 0;
+	}
+
+	for (line = text; line < end; line_no++)
+	{
+		const gchar	*eol = memchr(line, '\n', end - line), *start, *last, *name;
+		gsize		name_len;
+
+		if (eol == NULL)
+			eol = end;
+		start = skip_space(line, eol);
+		for (last = eol; last > start && g_ascii_isspace(last[-1]); last--)
+			;
+		if (start == eol || strchr(comment, *start) != NULL || (lang == SYMBOLS_LANGUAGE_C && *start == '#'))
+		{
+			/* C's #define is the one kind of comment-like line that defines something. */
+			if (lang == SYMBOLS_LANGUAGE_C && eol - start > 7 && strncmp(start, "#define", 7) == 0)
+			{
+				const gchar	*p = skip_space(start + 7, eol);
+
+				for (name = p; p < eol && is_ident(*p, lang); p++)
+					;
+				if (p > name)
+				{
+					emit(out, line_no, name, p - name);
+					count++;
+				}
+			}
+		}
+		else if (((lang == SYMBOLS_LANGUAGE_C || lang == SYMBOLS_LANGUAGE_SHELL) && find_c_function(line, eol, lang, keywords, &name, &name_len)) ||
+			find_keyword(start, eol, lang, keywords, &name, &name_len))
+		{
+			/* Skip forward declarations, like "struct foo;". */
+			if (lang != SYMBOLS_LANGUAGE_C || last[-1] != ';')
+			{
+				emit(out, line_no, name, name_len);
+				count++;
+			}
+		}
+		line = eol + 1;
+	}
+	return count;
+}
@@ -0,0 +1,39 @@
+/*
+ * Symbol extraction: finds the names of functions, types and so on in source files, line by line.
+ *
+ * Copyright (C) 2023 by Emil Brink <emil@obsession.se>.
+ *
+ * This file is part of gitbrowser.
+ *
+ * gitbrowser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * gitbrowser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with gitbrowser.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <glib.h>
+
+typedef enum {
+	SYMBOLS_LANGUAGE_NONE = 0,
+	SYMBOLS_LANGUAGE_C,			/* Also C++, Java, C#, JavaScript, Go, Rust and other curly-brace languages. */
+	SYMBOLS_LANGUAGE_PYTHON,
+	SYMBOLS_LANGUAGE_RUBY,
+	SYMBOLS_LANGUAGE_PERL,
+	SYMBOLS_LANGUAGE_LUA,
+	SYMBOLS_LANGUAGE_SHELL,
+} SymbolsLanguage;
+
+SymbolsLanguage	symbols_language_from_filename(const gchar *filename);
+
+/* Appends one "<line>\t<name>\n" record to <out> for each symbol found. Line numbers start at 1.
+ * This only reads <text>, and keeps no state, so it's fine to call from any thread.
+*/
+guint		symbols_extract(SymbolsLanguage lang, const gchar *text, gsize len, GString *out);